@@ -1,10 +1,19 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+from esphome import automation
 from esphome.components.display import Display
 from esphome.components.font import Font
 from esphome.components.time import RealTimeClock
 from esphome.components import color
-from esphome.const import CONF_ID, CONF_DISPLAY_ID, CONF_TIME_ID, CONF_SHOW_UNITS, __version__ as ESPHOME_VERSION
+from esphome.const import (
+    CONF_ID,
+    CONF_DISPLAY_ID,
+    CONF_TIME_ID,
+    CONF_SHOW_UNITS,
+    CONF_TRIGGER_ID,
+    CONF_UPDATE_INTERVAL,
+    __version__ as ESPHOME_VERSION,
+)
 from esphome.types import ConfigType
 from esphome.components import esp32
 from esphome.components.esp32 import (
@@ -18,6 +27,8 @@ AUTO_LOAD = ["json"]
 
 transit_tracker_ns = cg.esphome_ns.namespace("transit_tracker")
 TransitTracker = transit_tracker_ns.class_("TransitTracker", cg.Component)
+IdleTrigger = transit_tracker_ns.class_("IdleTrigger", automation.Trigger.template())
+ActiveTrigger = transit_tracker_ns.class_("ActiveTrigger", automation.Trigger.template())
 
 UnitDisplay = transit_tracker_ns.enum("UnitDisplay")
 UNIT_DISPLAY_VALUES = {
@@ -26,6 +37,12 @@ UNIT_DISPLAY_VALUES = {
     "none": UnitDisplay.UNIT_DISPLAY_NONE,
 }
 
+MemoryPlacement = transit_tracker_ns.enum("MemoryPlacement")
+MEMORY_PLACEMENT_VALUES = {
+    "internal": MemoryPlacement.MEMORY_PLACEMENT_INTERNAL,
+    "psram": MemoryPlacement.MEMORY_PLACEMENT_PSRAM,
+}
+
 CONF_ROUTES = "routes"
 CONF_STOPS = "stops"
 CONF_BASE_URL = "base_url"
@@ -41,6 +58,21 @@ CONF_LIST_MODE = "list_mode"
 CONF_SCROLL_HEADSIGNS = "scroll_headsigns"
 CONF_HEADERS = "headers"
 CONF_HEADER_TEXT = "header_text"
+CONF_MEMORY_PLACEMENT = "memory_placement"
+CONF_PROFILE_FRAMES = "profile_frames"
+CONF_IDLE_MODE = "idle_mode"
+CONF_IDLE_AFTER = "idle_after"
+CONF_PING_INTERVAL = "ping_interval"
+CONF_QUIET_HOURS = "quiet_hours"
+CONF_START_HOUR = "start_hour"
+CONF_END_HOUR = "end_hour"
+CONF_ON_IDLE = "on_idle"
+CONF_ON_ACTIVE = "on_active"
+CONF_COMPRESSION = "compression"
+CONF_COMPRESSION_WINDOW_BITS = "compression_window_bits"
+CONF_SUBSCRIPTION_ENCODING = "subscription_encoding"
+CONF_RECONNECT_DELAY = "reconnect_delay"
+CONF_MAX_RECONNECT_DELAY = "max_reconnect_delay"
 
 def validate_ws_url(value):
     url = cv.url(value)
@@ -59,6 +91,14 @@ def validate_esphome_version(obj):
     return obj
 
 
+def _validate_reconnect_delays(config: ConfigType) -> ConfigType:
+    if config[CONF_MAX_RECONNECT_DELAY] < config[CONF_RECONNECT_DELAY]:
+        raise cv.Invalid(
+            f"{CONF_MAX_RECONNECT_DELAY} must be at least {CONF_RECONNECT_DELAY}"
+        )
+    return config
+
+
 def _consume_transit_tracker_sockets(config: ConfigType) -> ConfigType:
     """Register socket needs for transit_tracker component."""
     from esphome.components import socket
@@ -72,6 +112,27 @@ COLOR_SCHEMA = cv.All(
 )
 
 
+IDLE_MODE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_IDLE_AFTER, default="60min"): cv.positive_time_period_seconds,
+        cv.Optional(CONF_UPDATE_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_PING_INTERVAL): cv.positive_time_period_seconds,
+        cv.Optional(CONF_QUIET_HOURS): cv.Schema(
+            {
+                cv.Required(CONF_START_HOUR): cv.int_range(min=0, max=23),
+                cv.Required(CONF_END_HOUR): cv.int_range(min=0, max=23),
+            }
+        ),
+        cv.Optional(CONF_ON_IDLE): automation.validate_automation(
+            {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(IdleTrigger)}
+        ),
+        cv.Optional(CONF_ON_ACTIVE): automation.validate_automation(
+            {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(ActiveTrigger)}
+        ),
+    }
+)
+
+
 CONFIG_SCHEMA = cv.All(
     validate_esphome_version,
     cv.only_on_esp32,
@@ -91,6 +152,15 @@ CONFIG_SCHEMA = cv.All(
                 "sequential", "nextPerRoute"
             ),
             cv.Optional(CONF_SCROLL_HEADSIGNS, default=False) : cv.boolean,
+            cv.Optional(CONF_MEMORY_PLACEMENT, default="psram"): cv.enum(MEMORY_PLACEMENT_VALUES),
+            cv.Optional(CONF_COMPRESSION, default=False): cv.boolean,
+            cv.Optional(CONF_PROFILE_FRAMES, default=False): cv.boolean,
+            cv.Optional(CONF_COMPRESSION_WINDOW_BITS, default=11): cv.int_range(min=9, max=15),
+            cv.Optional(CONF_RECONNECT_DELAY, default="5s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_MAX_RECONNECT_DELAY, default="30s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_SUBSCRIPTION_ENCODING, default="pairs"): cv.one_of(
+                "pairs", "grouped"
+            ),
             cv.Optional(CONF_STOPS, default=[]): cv.ensure_list(
                 cv.Schema(
                     {
@@ -101,6 +171,7 @@ CONFIG_SCHEMA = cv.All(
                 )
             ),
             cv.Optional(CONF_HEADER_TEXT, default=""): cv.string,
+            cv.Optional(CONF_IDLE_MODE): IDLE_MODE_SCHEMA,
             cv.Optional(CONF_SHOW_UNITS, default="long"): cv.enum(UNIT_DISPLAY_VALUES),
             cv.Optional(CONF_DEFAULT_ROUTE_COLOR): COLOR_SCHEMA,
             cv.Optional(CONF_REALTIME_COLOR): COLOR_SCHEMA,
@@ -131,6 +202,7 @@ CONFIG_SCHEMA = cv.All(
             ),
         }
     ).extend(cv.COMPONENT_SCHEMA),
+    _validate_reconnect_delays,
     _consume_transit_tracker_sockets,
 )
 
@@ -145,6 +217,23 @@ def _generate_schedule_string(stops):
     )
 
 
+def _generate_grouped_schedule_string(stops):
+    # One entry per stop/offset with its routes listed once, instead of
+    # repeating the stop for every route: "stop,offset:route,route;..."
+    groups = {}
+    for stop in stops:
+        key = (stop["stop_id"], stop["time_offset"].total_seconds)
+        routes = groups.setdefault(key, [])
+        routes.extend(route for route in stop[CONF_ROUTES] if route not in routes)
+
+    return ";".join(
+        [
+            f"{stop_id},{offset}:{','.join(routes)}"
+            for (stop_id, offset), routes in groups.items()
+        ]
+    )
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
 
@@ -161,7 +250,11 @@ async def to_code(config):
         cg.add(var.set_base_url(config[CONF_BASE_URL]))
 
     cg.add(var.set_feed_code(config[CONF_FEED_CODE]))
-    cg.add(var.set_schedule_string(_generate_schedule_string(config[CONF_STOPS])))
+    if config[CONF_SUBSCRIPTION_ENCODING] == "grouped":
+        cg.add(var.set_grouped_schedule(True))
+        cg.add(var.set_schedule_string(_generate_grouped_schedule_string(config[CONF_STOPS])))
+    else:
+        cg.add(var.set_schedule_string(_generate_schedule_string(config[CONF_STOPS])))
 
     display_departure_times = config[CONF_TIME_DISPLAY] == "departure"
     cg.add(var.set_display_departure_times(display_departure_times))
@@ -171,6 +264,16 @@ async def to_code(config):
 
     cg.add(var.set_limit(config[CONF_LIMIT]))
 
+    cg.add(var.set_memory_placement(config[CONF_MEMORY_PLACEMENT]))
+
+    if config[CONF_PROFILE_FRAMES]:
+        cg.add_define("USE_TRANSIT_TRACKER_PROFILER")
+
+    cg.add(var.set_compression(config[CONF_COMPRESSION]))
+    cg.add(var.set_compression_window_bits(config[CONF_COMPRESSION_WINDOW_BITS]))
+    cg.add(var.set_reconnect_delay(config[CONF_RECONNECT_DELAY].total_milliseconds))
+    cg.add(var.set_max_reconnect_delay(config[CONF_MAX_RECONNECT_DELAY].total_milliseconds))
+
     if CONF_HEADER_TEXT in config:
         cg.add(var.set_header_text(config[CONF_HEADER_TEXT]))
 
@@ -203,6 +306,27 @@ async def to_code(config):
             color_struct = await cg.get_variable(style["color"])
             cg.add(var.add_route_style(style["route_id"], style["name"], color_struct))
 
+    if CONF_IDLE_MODE in config:
+        idle_mode = config[CONF_IDLE_MODE]
+        cg.add(var.set_idle_enabled(True))
+        cg.add(var.set_idle_threshold(idle_mode[CONF_IDLE_AFTER].total_seconds))
+        cg.add(var.set_idle_update_interval(idle_mode[CONF_UPDATE_INTERVAL].total_milliseconds))
+
+        if CONF_PING_INTERVAL in idle_mode:
+            cg.add(var.set_idle_ping_interval(idle_mode[CONF_PING_INTERVAL].total_seconds))
+
+        if CONF_QUIET_HOURS in idle_mode:
+            quiet_hours = idle_mode[CONF_QUIET_HOURS]
+            cg.add(var.set_quiet_hours(quiet_hours[CONF_START_HOUR], quiet_hours[CONF_END_HOUR]))
+
+        for conf in idle_mode.get(CONF_ON_IDLE, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+            await automation.build_automation(trigger, [], conf)
+
+        for conf in idle_mode.get(CONF_ON_ACTIVE, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+            await automation.build_automation(trigger, [], conf)
+
     await cg.register_component(var, config)
 
     add_idf_component(
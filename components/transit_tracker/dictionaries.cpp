@@ -0,0 +1,157 @@
+#include "dictionaries.h"
+#include "string_utils.h"
+
+#include "esp_timer.h"
+#include "nvs.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *const TAG = "transit_tracker.dictionaries";
+
+static const char *const NVS_NAMESPACE = "transit_tracker";
+static const char *const NVS_KEY = "dictionaries";
+
+// Below everything else the device does; the write just has to land eventually
+static constexpr uint32_t WRITER_TASK_STACK_SIZE = 4096;
+static constexpr UBaseType_t WRITER_TASK_PRIORITY = tskIDLE_PRIORITY + 1;
+
+bool parse_remote_dictionaries(JsonObject data, RemoteDictionaries &out) {
+  const char *version = data["version"] | "";
+  if (*version == '\0') {
+    return false;
+  }
+  out.version = version;
+
+  for (JsonObject abbr : data["abbreviations"].as<JsonArray>()) {
+    const char *from = abbr["from"] | "";
+    if (*from == '\0') {
+      continue;
+    }
+    out.abbreviations[from] = abbr["to"] | "";
+  }
+
+  for (JsonObject style : data["routeStyles"].as<JsonArray>()) {
+    const char *route_id = style["routeId"] | "";
+    uint32_t color;
+    if (*route_id == '\0' || !parse_hex_color(style["color"] | "", color)) {
+      ESP_LOGW(TAG, "Ignoring invalid route style for route '%s'", route_id);
+      continue;
+    }
+    out.route_styles[route_id] = RouteStyle{style["name"] | "", Color(color)};
+  }
+
+  return true;
+}
+
+std::shared_ptr<const Dictionaries> compile_dictionaries(const RemoteDictionaries *remote,
+                                                         const AbbreviationMap &abbreviations,
+                                                         const RouteStyleMap &route_styles) {
+  auto compiled = std::make_shared<Dictionaries>();
+
+  AbbreviationMap merged_abbreviations;
+  if (remote != nullptr) {
+    merged_abbreviations = remote->abbreviations;
+    compiled->route_styles = remote->route_styles;
+  }
+
+  for (const auto &abbr : abbreviations) {
+    merged_abbreviations[abbr.first] = abbr.second;
+  }
+  for (const auto &style : route_styles) {
+    compiled->route_styles[style.first] = style.second;
+  }
+
+  compiled->abbreviations.assign(merged_abbreviations.begin(), merged_abbreviations.end());
+  return compiled;
+}
+
+bool DictionaryCache::load(std::string &payload) {
+  nvs_handle_t handle;
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+    return false;
+  }
+
+  size_t size = 0;
+  esp_err_t err = nvs_get_blob(handle, NVS_KEY, nullptr, &size);
+  if (err == ESP_OK && size > 0 && size <= MAX_PAYLOAD_SIZE) {
+    payload.resize(size);
+    err = nvs_get_blob(handle, NVS_KEY, payload.data(), &size);
+  } else if (err == ESP_OK) {
+    err = ESP_ERR_INVALID_SIZE;
+  }
+
+  nvs_close(handle);
+
+  if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+    ESP_LOGW(TAG, "Failed to read cached dictionaries: %s", esp_err_to_name(err));
+  }
+  return err == ESP_OK;
+}
+
+void DictionaryCache::save_async(BulkString &&payload) {
+  if (payload.size() > MAX_PAYLOAD_SIZE) {
+    ESP_LOGW(TAG, "Dictionaries too large to cache (%u bytes)", static_cast<unsigned>(payload.size()));
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->pending_payload_ = std::move(payload);
+  }
+
+  if (this->writer_task_handle_ == nullptr &&
+      xTaskCreate(DictionaryCache::writer_task_, "tt_dict_cache", WRITER_TASK_STACK_SIZE, this,
+                  WRITER_TASK_PRIORITY, &this->writer_task_handle_) != pdPASS) {
+    ESP_LOGW(TAG, "Failed to start the cache writer task; dictionaries will not be cached");
+    this->writer_task_handle_ = nullptr;
+    return;
+  }
+
+  xTaskNotifyGive(this->writer_task_handle_);
+}
+
+void DictionaryCache::writer_task_(void *arg) {
+  auto *cache = static_cast<DictionaryCache *>(arg);
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Only the newest payload is written; anything queued while the last write ran was replaced
+    BulkString payload;
+    {
+      std::lock_guard<std::mutex> lock(cache->mutex_);
+      payload.swap(cache->pending_payload_);
+    }
+    if (payload.empty()) {
+      continue;
+    }
+
+    int64_t started_us = esp_timer_get_time();
+    if (cache->save_(std::string_view(payload.data(), payload.size()))) {
+      ESP_LOGD(TAG, "Cached dictionaries (%u bytes) in %u ms", static_cast<unsigned>(payload.size()),
+               static_cast<unsigned>((esp_timer_get_time() - started_us) / 1000));
+    }
+  }
+}
+
+bool DictionaryCache::save_(std::string_view payload) {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(handle, NVS_KEY, payload.data(), payload.size());
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to cache dictionaries: %s", esp_err_to_name(err));
+    return false;
+  }
+  return true;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/color.h"
+#include "esphome/components/json/json_util.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "memory.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+struct RouteStyle {
+  std::string name;
+  Color color;
+};
+
+using AbbreviationMap = std::map<std::string, std::string>;
+using RouteStyleMap = std::map<std::string, RouteStyle, std::less<>>;
+
+/// Abbreviations and route styles merged into the form ScheduleFeed consumes.
+/// Instances are immutable once published, so the parser can hold one while a new set is installed.
+struct Dictionaries {
+  std::vector<std::pair<std::string, std::string>> abbreviations;
+  RouteStyleMap route_styles;
+};
+
+/// Dictionaries pushed by the server, identified by the version hash it sent with them.
+struct RemoteDictionaries {
+  std::string version;
+  AbbreviationMap abbreviations;
+  RouteStyleMap route_styles;
+};
+
+/// Reads a "dictionaries" event's data object. Returns false if it has no version.
+bool parse_remote_dictionaries(JsonObject data, RemoteDictionaries &out);
+
+/// Merges server dictionaries with locally configured ones; local entries win.
+std::shared_ptr<const Dictionaries> compile_dictionaries(const RemoteDictionaries *remote,
+                                                         const AbbreviationMap &abbreviations,
+                                                         const RouteStyleMap &route_styles);
+
+/// Persists the last received dictionaries message in NVS so it survives reboots.
+/// Writes happen on a low-priority task, since erasing flash can block for tens of ms.
+class DictionaryCache {
+  public:
+    static constexpr size_t MAX_PAYLOAD_SIZE = 16384;
+
+    bool load(std::string &payload);
+    /// Queues the payload for the writer task. A newer payload replaces one not yet written.
+    void save_async(BulkString &&payload);
+
+  protected:
+    bool save_(std::string_view payload);
+    static void writer_task_(void *arg);
+
+    std::mutex mutex_;
+    BulkString pending_payload_;  // empty when nothing is waiting
+    TaskHandle_t writer_task_handle_ = nullptr;
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
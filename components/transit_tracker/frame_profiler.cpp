@@ -0,0 +1,61 @@
+#include "frame_profiler.h"
+
+#ifdef USE_TRANSIT_TRACKER_PROFILER
+
+#include <algorithm>
+
+#include "esp_rom_sys.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *const STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+  "frame", "lock", "layout", "print", "clip", "icon",
+};
+
+static constexpr size_t HISTOGRAM_BUCKETS = 12;  // <1us, <2us, <4us, ... >=1024us
+
+void FrameProfiler::dump(const char *tag) const {
+  const uint32_t cycles_per_us = esp_rom_get_cpu_ticks_per_us();
+
+  ESP_LOGI(tag, "Frame profile (last %u samples per stage, microseconds):",
+           static_cast<unsigned>(SAMPLES_PER_STAGE));
+
+  for (size_t stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+    const Ring &ring = this->rings_[stage];
+    if (ring.count == 0) {
+      ESP_LOGI(tag, "  %-6s no samples", STAGE_NAMES[stage]);
+      continue;
+    }
+
+    uint32_t sorted[SAMPLES_PER_STAGE];
+    std::copy(ring.samples, ring.samples + ring.count, sorted);
+    std::sort(sorted, sorted + ring.count);
+
+    uint16_t histogram[HISTOGRAM_BUCKETS] = {};
+    for (size_t i = 0; i < ring.count; i++) {
+      uint32_t us = sorted[i] / cycles_per_us;
+      size_t bucket = 0;
+      while (us > 0 && bucket < HISTOGRAM_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+      }
+      histogram[bucket]++;
+    }
+
+    ESP_LOGI(tag, "  %-6s n=%u p50=%u p90=%u p99=%u max=%u", STAGE_NAMES[stage], ring.count,
+             static_cast<unsigned>(sorted[ring.count / 2] / cycles_per_us),
+             static_cast<unsigned>(sorted[ring.count * 9 / 10] / cycles_per_us),
+             static_cast<unsigned>(sorted[ring.count * 99 / 100] / cycles_per_us),
+             static_cast<unsigned>(sorted[ring.count - 1] / cycles_per_us));
+    ESP_LOGI(tag, "         <1:%u <2:%u <4:%u <8:%u <16:%u <32:%u <64:%u <128:%u <256:%u <512:%u <1024:%u >=1024:%u",
+             histogram[0], histogram[1], histogram[2], histogram[3], histogram[4], histogram[5],
+             histogram[6], histogram[7], histogram[8], histogram[9], histogram[10], histogram[11]);
+  }
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_TRANSIT_TRACKER_PROFILER
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_cpu.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+enum ProfileStage : uint8_t {
+  PROFILE_STAGE_FRAME,
+  PROFILE_STAGE_LOCK,
+  PROFILE_STAGE_LAYOUT,
+  PROFILE_STAGE_PRINT,
+  PROFILE_STAGE_CLIP,
+  PROFILE_STAGE_ICON,
+  PROFILE_STAGE_COUNT,
+};
+
+/// Keeps the most recent cycle counts for each draw_schedule() stage in fixed ring buffers.
+class FrameProfiler {
+  public:
+    static constexpr size_t SAMPLES_PER_STAGE = 128;
+
+    void record(ProfileStage stage, uint32_t cycles) {
+      Ring &ring = this->rings_[stage];
+      ring.samples[ring.next] = cycles;
+      ring.next = (ring.next + 1) % SAMPLES_PER_STAGE;
+      if (ring.count < SAMPLES_PER_STAGE) {
+        ring.count++;
+      }
+    }
+
+    /// Logs percentiles and a log2 histogram (in microseconds) for every stage.
+    void dump(const char *tag) const;
+
+  protected:
+    struct Ring {
+      uint32_t samples[SAMPLES_PER_STAGE];
+      uint16_t next;
+      uint16_t count;
+    };
+
+    Ring rings_[PROFILE_STAGE_COUNT]{};
+};
+
+class ScopedStageTimer {
+  public:
+    ScopedStageTimer(FrameProfiler &profiler, ProfileStage stage)
+        : profiler_(profiler), stage_(stage), start_(esp_cpu_get_cycle_count()) {}
+    ~ScopedStageTimer() { this->profiler_.record(this->stage_, esp_cpu_get_cycle_count() - this->start_); }
+
+  protected:
+    FrameProfiler &profiler_;
+    ProfileStage stage_;
+    uint32_t start_;
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
+
+// Times the rest of the enclosing scope
+#define TT_PROFILE_SCOPE(stage) ScopedStageTimer _tt_scope_timer(this->profiler_, stage)
+// Times a single statement
+#define TT_PROFILE(stage, ...) \
+  do { \
+    ScopedStageTimer _tt_timer(this->profiler_, stage); \
+    __VA_ARGS__; \
+  } while (0)
+
+#else
+
+#define TT_PROFILE_SCOPE(stage)
+#define TT_PROFILE(stage, ...) \
+  do { \
+    __VA_ARGS__; \
+  } while (0)
+
+#endif
@@ -0,0 +1,119 @@
+#include "json_scan.h"
+
+#include <cctype>
+
+namespace esphome {
+namespace transit_tracker {
+
+static size_t skip_space(const char *data, size_t len, size_t i) {
+  while (i < len && isspace(static_cast<unsigned char>(data[i]))) {
+    i++;
+  }
+  return i;
+}
+
+void LeadingTripScanner::reset(size_t count) {
+  *this = LeadingTripScanner();
+  count_ = count;
+}
+
+std::string_view LeadingTripScanner::event(const char *data) const {
+  if (event_state_ != EVENT_FOUND) {
+    return {};
+  }
+  return std::string_view(data + event_start_, event_len_);
+}
+
+void LeadingTripScanner::scan(const char *data, size_t len) {
+  size_t i = pos_;
+  while (i < len && !done_()) {
+    char c = data[i];
+    if (c == '{' || c == '[') {
+      depth_++;
+    } else if (c == '}' || c == ']') {
+      if (depth_ == array_depth_ && trips_ == TripScan::PENDING) {
+        trips_ = TripScan::CLOSED;
+      }
+      depth_--;
+      // unbalanced input can bring depth down to -1 before any array was seen
+      if (c == '}' && array_depth_ >= 0 && depth_ == array_depth_ && trips_ == TripScan::PENDING &&
+          ++found_ == count_) {
+        trips_ = TripScan::FOUND;
+        array_end_ = i + 1;
+      }
+    } else if (c == '"') {
+      // An incomplete token is left for the next call to start over on
+      const size_t quote = i;
+      size_t start = ++i;
+      while (i < len && data[i] != '"') {
+        i += data[i] == '\\' ? 2 : 1;
+      }
+      if (i >= len) {
+        pos_ = quote;
+        return;
+      }
+      std::string_view str(data + start, i - start);
+
+      const bool is_event = event_state_ == EVENT_UNKNOWN && depth_ == 1 && str == "event";
+      const bool is_trips = count_ > 0 && array_depth_ < 0 && str == "trips";
+      if (is_event || is_trips) {
+        // Only a key if followed by ':'
+        size_t j = skip_space(data, len, i + 1);
+        const bool is_key = j < len && data[j] == ':';
+        if (is_key) {
+          j = skip_space(data, len, j + 1);
+        }
+        if (j >= len) {
+          pos_ = quote;
+          return;
+        }
+
+        if (!is_key) {
+          // a string value that happens to match
+        } else if (is_event) {
+          if (data[j] != '"') {
+            event_state_ = EVENT_INVALID;
+          } else {
+            size_t k = j + 1;
+            while (k < len && data[k] != '"' && data[k] != '\\') {
+              k++;
+            }
+            if (k >= len) {
+              pos_ = quote;
+              return;
+            }
+            event_state_ = data[k] == '"' ? EVENT_FOUND : EVENT_INVALID;
+            event_start_ = j + 1;
+            event_len_ = k - j - 1;
+          }
+        } else if (data[j] == '[') {
+          array_start_ = j;
+          array_depth_ = ++depth_;
+          i = j;
+        }
+      }
+    }
+    i++;
+  }
+  pos_ = i;
+}
+
+std::string_view peek_event(const char *data, size_t len) {
+  LeadingTripScanner scanner;
+  scanner.scan(data, len);
+  return scanner.event(data);
+}
+
+TripScan find_leading_trips(const char *data, size_t len, size_t count, size_t &array_start, size_t &array_end) {
+  LeadingTripScanner scanner;
+  scanner.reset(count);
+  scanner.scan(data, len);
+  if (scanner.trips() == TripScan::FOUND) {
+    array_start = scanner.array_start();
+    array_end = scanner.array_end();
+  }
+  return scanner.trips();
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace esphome {
+namespace transit_tracker {
+
+// Scanners over raw JSON text, for routing and early rendering without building a document.
+// They never read past `len` and tolerate truncated or malformed input.
+
+enum class TripScan { PENDING, FOUND, CLOSED };
+
+/// Looks for the top-level "event" value and the first `count` complete objects of the
+/// "trips" array in a message that is still arriving. Each scan() resumes where the last
+/// one stopped, so a message fed in many fragments is only walked once.
+class LeadingTripScanner {
+ public:
+  /// Starts over on a new message. With a `count` of 0 only the event is looked for.
+  void reset(size_t count);
+  /// Scans what was added since the last call. `data` holds everything received of the
+  /// message so far; it may move between calls but must only grow.
+  void scan(const char *data, size_t len);
+
+  /// True once the event value has been seen, or found not to be a plain string.
+  bool has_event() const { return event_state_ != EVENT_UNKNOWN; }
+  /// The event value, or an empty view if unknown or not a plain string.
+  std::string_view event(const char *data) const;
+
+  /// FOUND: [array_start(), array_end()) covers the opening '[' through the last of the
+  /// first `count` objects. CLOSED: the array ended with fewer.
+  TripScan trips() const { return trips_; }
+  size_t array_start() const { return array_start_; }
+  size_t array_end() const { return array_end_; }
+
+ protected:
+  enum EventState { EVENT_UNKNOWN, EVENT_FOUND, EVENT_INVALID };
+
+  bool done_() const { return event_state_ != EVENT_UNKNOWN && (count_ == 0 || trips_ != TripScan::PENDING); }
+
+  size_t count_{0};
+  size_t pos_{0};  // next byte to scan; always at a token boundary
+  int depth_{0};
+  int array_depth_{-1};
+  size_t found_{0};
+  TripScan trips_{TripScan::PENDING};
+  size_t array_start_{0};
+  size_t array_end_{0};
+  EventState event_state_{EVENT_UNKNOWN};
+  size_t event_start_{0};
+  size_t event_len_{0};
+};
+
+/// Finds the value of the top-level "event" key. Returns an empty view if the key
+/// isn't found or its value isn't a plain string.
+std::string_view peek_event(const char *data, size_t len);
+
+/// One-shot LeadingTripScanner over `len` bytes.
+TripScan find_leading_trips(const char *data, size_t len, size_t count, size_t &array_start, size_t &array_end);
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -1,5 +1,9 @@
 #include "localization.h"
 
+#include <climits>
+
+#include "esphome/core/helpers.h"
+
 namespace esphome {
 namespace transit_tracker {
 
@@ -48,5 +52,24 @@ std::string Localization::fmt_duration_from_now(time_t unix_timestamp, uint rtc_
   }
 }
 
+uint Localization::next_change(time_t unix_timestamp, uint rtc_now) const {
+  int diff = unix_timestamp - rtc_now;
+
+  // "Now" sticks until the trip is removed
+  if (diff < 30) {
+    return UINT_MAX;
+  }
+
+  // "0min" flips to "Now" once fewer than 30 seconds remain
+  if (diff < 60) {
+    return unix_timestamp - 29;
+  }
+
+  // Every unit display mode only depends on whole minutes remaining, so the
+  // string changes as soon as the remaining time drops below the current minute
+  int minutes = diff / 60;
+  return unix_timestamp - minutes * 60 + 1;
+}
+
 }
 }
\ No newline at end of file
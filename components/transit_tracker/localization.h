@@ -16,14 +16,21 @@ enum UnitDisplay : uint8_t {
 class Localization {
   public:
     std::string fmt_duration_from_now(time_t unix_timestamp, uint rtc_now) const;
+    /// Returns the RTC time at which fmt_duration_from_now() will next produce a different
+    /// string for this timestamp, or UINT_MAX if it never will.
+    uint next_change(time_t unix_timestamp, uint rtc_now) const;
 
-    void set_unit_display(UnitDisplay unit_display) { unit_display_ = unit_display; }
-    void set_now_string(const std::string &now_string) { now_string_ = now_string; }
-    void set_minutes_long_string(const std::string &minutes_long_string) { minutes_long_string_ = minutes_long_string; }
-    void set_minutes_short_string(const std::string &minutes_short_string) { minutes_short_string_ = minutes_short_string; }
-    void set_hours_short_string(const std::string &hours_short_string) { hours_short_string_ = hours_short_string; }
+    /// Incremented whenever a setting that affects formatting changes.
+    uint32_t get_revision() const { return revision_; }
+
+    void set_unit_display(UnitDisplay unit_display) { unit_display_ = unit_display; revision_++; }
+    void set_now_string(const std::string &now_string) { now_string_ = now_string; revision_++; }
+    void set_minutes_long_string(const std::string &minutes_long_string) { minutes_long_string_ = minutes_long_string; revision_++; }
+    void set_minutes_short_string(const std::string &minutes_short_string) { minutes_short_string_ = minutes_short_string; revision_++; }
+    void set_hours_short_string(const std::string &hours_short_string) { hours_short_string_ = hours_short_string; revision_++; }
 
   protected:
+    uint32_t revision_ = 0;
     UnitDisplay unit_display_ = UNIT_DISPLAY_LONG;
     std::string now_string_ = "Now";
     std::string minutes_long_string_ = "min";
@@ -0,0 +1,60 @@
+#include "memory.h"
+
+#include <algorithm>
+
+#include "esp_heap_caps.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static MemoryPlacement bulk_memory_placement = MEMORY_PLACEMENT_PSRAM;
+
+void set_bulk_memory_placement(MemoryPlacement placement) { bulk_memory_placement = placement; }
+MemoryPlacement get_bulk_memory_placement() { return bulk_memory_placement; }
+
+void *bulk_malloc(size_t size) {
+  if (bulk_memory_placement == MEMORY_PLACEMENT_PSRAM) {
+    return heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_8BIT);
+  }
+  return heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void *bulk_realloc(void *ptr, size_t size) {
+  if (bulk_memory_placement == MEMORY_PLACEMENT_PSRAM) {
+    return heap_caps_realloc_prefer(ptr, size, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_8BIT);
+  }
+  return heap_caps_realloc(ptr, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void bulk_free(void *ptr) { heap_caps_free(ptr); }
+
+size_t bulk_largest_free_block() {
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (bulk_memory_placement == MEMORY_PLACEMENT_PSRAM) {
+    largest = std::max(largest, heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  }
+  return largest;
+}
+
+void log_heap_stats(const char *tag) {
+  ESP_LOGD(tag, "Internal heap: free=%u min_free=%u largest_block=%u",
+           static_cast<unsigned>(heap_caps_get_free_size(MALLOC_CAP_INTERNAL)),
+           static_cast<unsigned>(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL)),
+           static_cast<unsigned>(heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL)));
+
+  if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0) {
+    ESP_LOGD(tag, "PSRAM heap: free=%u min_free=%u largest_block=%u",
+             static_cast<unsigned>(heap_caps_get_free_size(MALLOC_CAP_SPIRAM)),
+             static_cast<unsigned>(heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM)),
+             static_cast<unsigned>(heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM)));
+  }
+}
+
+BulkJsonAllocator *BulkJsonAllocator::instance() {
+  static BulkJsonAllocator allocator;
+  return &allocator;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
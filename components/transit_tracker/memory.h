@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "esphome/components/json/json_util.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+/// Where bulk data (received messages, JSON documents, trips) is allocated.
+/// Hot render data always stays in internal RAM.
+enum MemoryPlacement : uint8_t {
+  MEMORY_PLACEMENT_INTERNAL,
+  MEMORY_PLACEMENT_PSRAM,
+};
+
+void set_bulk_memory_placement(MemoryPlacement placement);
+MemoryPlacement get_bulk_memory_placement();
+
+/// Allocates from PSRAM when configured and available, falling back to internal RAM.
+void *bulk_malloc(size_t size);
+void *bulk_realloc(void *ptr, size_t size);
+void bulk_free(void *ptr);
+/// The largest single allocation bulk_malloc() can currently satisfy.
+size_t bulk_largest_free_block();
+
+void log_heap_stats(const char *tag);
+
+template<typename T> class BulkAllocator {
+  public:
+    using value_type = T;
+
+    BulkAllocator() = default;
+    template<typename U> BulkAllocator(const BulkAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+      void *ptr = bulk_malloc(n * sizeof(T));
+      if (ptr == nullptr) {
+        abort();
+      }
+      return static_cast<T *>(ptr);
+    }
+    void deallocate(T *ptr, size_t) { bulk_free(ptr); }
+
+    template<typename U> bool operator==(const BulkAllocator<U> &) const { return true; }
+    template<typename U> bool operator!=(const BulkAllocator<U> &) const { return false; }
+};
+
+using BulkString = std::basic_string<char, std::char_traits<char>, BulkAllocator<char>>;
+template<typename T> using BulkVector = std::vector<T, BulkAllocator<T>>;
+
+/// ArduinoJson allocator backed by bulk memory.
+class BulkJsonAllocator : public ArduinoJson::Allocator {
+  public:
+    static BulkJsonAllocator *instance();
+
+    void *allocate(size_t size) override { return bulk_malloc(size); }
+    void deallocate(void *ptr) override { bulk_free(ptr); }
+    void *reallocate(void *ptr, size_t new_size) override { return bulk_realloc(ptr, new_size); }
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
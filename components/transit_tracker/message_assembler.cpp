@@ -0,0 +1,194 @@
+#include "message_assembler.h"
+
+#include <algorithm>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *const TAG = "transit_tracker.ws";
+
+static constexpr uint8_t OP_CONTINUATION = 0x00;
+static constexpr uint8_t OP_TEXT = 0x01;
+static constexpr uint8_t OP_BINARY = 0x02;
+static constexpr uint8_t OP_CLOSE = 0x08;
+
+// RFC 7692: each compressed message has the trailing empty stored block stripped
+static const uint8_t DEFLATE_TRAILER[] = {0x00, 0x00, 0xff, 0xff};
+
+void MessageAssembler::feed(const FrameChunk &chunk) {
+  const uint8_t op = chunk.op_code;
+
+  // Log close frames for diagnostics before the connection tears down
+  if (op == OP_CLOSE && chunk.data_len >= 2) {
+    auto bytes = reinterpret_cast<const uint8_t *>(chunk.data);
+    uint16_t close_code = (static_cast<uint16_t>(bytes[0]) << 8) | bytes[1];
+    if (chunk.data_len > 2) {
+      ESP_LOGW(TAG, "Server sent close: code=%u reason=\"%.*s\"", close_code, chunk.data_len - 2, chunk.data + 2);
+    } else {
+      ESP_LOGW(TAG, "Server sent close: code=%u", close_code);
+    }
+    return;
+  }
+
+  const bool is_data_frame = (op == OP_CONTINUATION || op == OP_TEXT || op == OP_BINARY);
+  if (!is_data_frame || chunk.payload_len <= 0) {
+    return;
+  }
+
+  auto bytes = reinterpret_cast<const uint8_t *>(chunk.data);
+  const bool message_start = op != OP_CONTINUATION && chunk.payload_offset == 0;
+
+  if (!message_start && !receiving_) {
+    // a continuation with no message in progress, e.g. after a reconnect mid-message
+    ESP_LOGW(TAG, "Dropping unexpected continuation (op=%u, offset=%d)", op, chunk.payload_offset);
+    return;
+  }
+
+  if (chunk.payload_offset == 0) {
+    frame_received_ = 0;
+  }
+
+  if (message_start) {
+    receiving_ = true;
+    message_buffer_.clear();
+    message_discarded_ = false;
+    if (on_message_start_) {
+      on_message_start_();
+    }
+
+    if (static_cast<size_t>(chunk.payload_len) > max_message_size_) {
+      ESP_LOGW(TAG, "Dropping oversized message (%d bytes)", chunk.payload_len);
+      message_discarded_ = true;
+    }
+
+    // esp_websocket_client doesn't surface RSV1, so tell the two apart by the first
+    // byte. Every message is a JSON object whose first literal is '{', so a
+    // compressed one starts with 0xAA/0xAB (a fixed Huffman block encoding '{',
+    // BFINAL clear or set) or with a stored or dynamic block header, never 0x7B.
+    // This relies on that first literal, not on BFINAL: RFC 7692 allows final
+    // blocks, and 0x7B on its own is a valid BFINAL=1 fixed Huffman header.
+    message_compressed_ = inflater_ != nullptr && chunk.data_len > 0 && bytes[0] != '{';
+    if (message_compressed_) {
+      inflater_->reset();
+    } else if (!message_discarded_) {
+      reserve_(chunk.payload_len);
+    }
+  }
+
+  wire_bytes_ += chunk.data_len;
+
+  // Chunks of a frame must arrive back to back and stay within its declared length
+  const bool in_order = chunk.payload_offset == frame_received_ && chunk.data_len >= 0 &&
+                        chunk.payload_offset + chunk.data_len <= chunk.payload_len;
+  frame_received_ = chunk.payload_offset + chunk.data_len;
+  if (!in_order && !message_discarded_) {
+    ESP_LOGW(TAG, "Dropping message with out-of-order fragment (offset=%d, len=%d, frame=%d)", chunk.payload_offset,
+             chunk.data_len, chunk.payload_len);
+    discard_(nullptr);
+  }
+
+  const bool message_end = chunk.fin && (chunk.payload_offset + chunk.data_len) >= chunk.payload_len;
+  if (message_end) {
+    receiving_ = false;
+  }
+
+  if (message_discarded_) {
+    return;
+  }
+
+  if (message_compressed_) {
+    if (!inflater_->inflate(bytes, chunk.data_len, *this)) {
+      discard_("Failed to inflate message; dropping it");
+      return;
+    }
+  } else if (!append(chunk.data, chunk.data_len)) {
+    return;
+  }
+
+  if (!message_end) {
+    if (on_partial_message_) {
+      on_partial_message_(message_buffer_);
+    }
+    return;
+  }
+
+  if (message_compressed_) {
+    if (!inflater_->inflate(DEFLATE_TRAILER, sizeof(DEFLATE_TRAILER), *this)) {
+      discard_("Failed to inflate message; dropping it");
+      return;
+    }
+    ESP_LOGV(TAG, "Inflated message to %u bytes", static_cast<unsigned>(message_buffer_.size()));
+  }
+
+  message_bytes_ += message_buffer_.size();
+
+  if (on_message_) {
+    on_message_(message_buffer_);
+  }
+  message_buffer_.clear();
+}
+
+void MessageAssembler::reset() {
+  message_buffer_.clear();
+  message_discarded_ = false;
+  frame_received_ = 0;
+  receiving_ = false;
+}
+
+bool MessageAssembler::append(const char *data, size_t len) {
+  if (message_discarded_) {
+    return false;
+  }
+  if (message_buffer_.size() + len > max_message_size_) {
+    ESP_LOGW(TAG, "Dropping message larger than %u bytes", static_cast<unsigned>(max_message_size_));
+    discard_(nullptr);
+    return false;
+  }
+  if (!reserve_(message_buffer_.size() + len)) {
+    return false;
+  }
+  message_buffer_.append(data, len);
+  return true;
+}
+
+bool MessageAssembler::reserve_(size_t size) {
+  if (size <= message_buffer_.capacity()) {
+    return true;
+  }
+
+  // BulkAllocator aborts when an allocation fails, so check the heap first and
+  // drop the message instead. Grow geometrically like append() would, falling
+  // back to an exact fit when memory is tight.
+  size_t capacity = std::min(std::max(size, message_buffer_.capacity() * 2), max_message_size_);
+  const size_t largest = bulk_largest_free_block();
+  if (capacity + 1 > largest) {
+    capacity = size;
+  }
+  if (capacity + 1 > largest) {
+    ESP_LOGW(TAG, "Not enough memory for a %u byte message (largest free block %u); dropping it",
+             static_cast<unsigned>(size), static_cast<unsigned>(largest));
+    discard_(nullptr);
+    return false;
+  }
+
+  // reserve() on a non-empty string may round up to double its capacity, so
+  // grow into a fresh string to get exactly what was checked
+  BulkString grown;
+  grown.reserve(capacity);
+  grown.append(message_buffer_);
+  message_buffer_.swap(grown);
+  return true;
+}
+
+void MessageAssembler::discard_(const char *reason) {
+  if (reason != nullptr) {
+    ESP_LOGW(TAG, "%s", reason);
+  }
+  message_buffer_.clear();
+  message_discarded_ = true;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "memory.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+/// One piece of a websocket frame, as esp_websocket_client hands it to WEBSOCKET_EVENT_DATA.
+/// Frames larger than the client's buffer arrive as several chunks of the same frame.
+struct FrameChunk {
+  uint8_t op_code;
+  bool fin;
+  int payload_len;     // length of the whole frame
+  int payload_offset;  // where this chunk starts within the frame
+  const char *data;
+  int data_len;
+};
+
+class MessageAssembler;
+
+/// Raw DEFLATE decoder used for permessage-deflate messages.
+class Inflater {
+ public:
+  virtual ~Inflater() = default;
+
+  /// Starts a new stream; called at the beginning of every compressed message.
+  virtual void reset() = 0;
+  /// Decodes `len` bytes, passing the output to `out.append()`. Returns false if the
+  /// stream is corrupt or `out` refused the data.
+  virtual bool inflate(const uint8_t *data, size_t len, MessageAssembler &out) = 0;
+};
+
+/// Reassembles complete messages from frame chunks. Chunks that don't continue the
+/// current frame, messages over the size limit and undecodable compressed messages
+/// are dropped whole; control frames are ignored.
+class MessageAssembler {
+ public:
+  using MessageCallback = std::function<void(const BulkString &)>;
+  using StartCallback = std::function<void()>;
+
+  static constexpr size_t DEFAULT_MAX_MESSAGE_SIZE = 128 * 1024;
+
+  /// Compressed messages are only recognized while an inflater is set.
+  void set_inflater(Inflater *inflater) { inflater_ = inflater; }
+  void set_max_message_size(size_t size) { max_message_size_ = size; }
+
+  void set_on_message(MessageCallback cb) { on_message_ = std::move(cb); }
+  /// Called with everything received so far after each chunk of a message that isn't complete yet.
+  void set_on_partial_message(MessageCallback cb) { on_partial_message_ = std::move(cb); }
+  /// Called when the first chunk of a new data message arrives.
+  void set_on_message_start(StartCallback cb) { on_message_start_ = std::move(cb); }
+
+  void feed(const FrameChunk &chunk);
+  /// Abandons any message in progress, e.g. because the connection dropped.
+  void reset();
+
+  /// Appends decoded message bytes. Returns false (and drops the message) if it would exceed the size limit.
+  bool append(const char *data, size_t len);
+
+  /// True while a fragmented message is partway through being received
+  bool is_receiving() const { return receiving_.load(); }
+  /// Total bytes of message payload received on the wire (compressed or not)
+  uint32_t get_wire_bytes() const { return wire_bytes_.load(); }
+  /// Total bytes of message payload after decompression
+  uint32_t get_message_bytes() const { return message_bytes_.load(); }
+
+ protected:
+  void discard_(const char *reason);
+  /// Grows the buffer to hold `size` bytes without risking an aborting allocation.
+  /// Returns false (and drops the message) if the heap can't fit it.
+  bool reserve_(size_t size);
+
+  Inflater *inflater_{nullptr};
+  size_t max_message_size_{DEFAULT_MAX_MESSAGE_SIZE};
+
+  MessageCallback on_message_;
+  MessageCallback on_partial_message_;
+  StartCallback on_message_start_;
+
+  BulkString message_buffer_;
+  bool message_compressed_{false};
+  bool message_discarded_{false};
+  // bytes of the current frame seen so far, to validate the next chunk's offset
+  int frame_received_{0};
+
+  std::atomic<bool> receiving_{false};
+  std::atomic<uint32_t> wire_bytes_{0};
+  std::atomic<uint32_t> message_bytes_{0};
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
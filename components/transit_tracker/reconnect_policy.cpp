@@ -0,0 +1,62 @@
+#include "reconnect_policy.h"
+
+#include <algorithm>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *const TAG = "transit_tracker.connection";
+
+// Doublings of the delay before it is held at the maximum; far past any sane cap
+static constexpr int MAX_BACKOFF_SHIFT = 10;
+
+uint32_t ReconnectBackoff::next_delay_ms(uint32_t random) {
+  int shift = std::min(attempts_++, MAX_BACKOFF_SHIFT);
+  uint32_t ceiling = std::min<uint64_t>(static_cast<uint64_t>(base_delay_ms_) << shift, max_delay_ms_);
+  return ceiling / 2 + random % (ceiling / 2 + 1);
+}
+
+RecoveryAction recovery_action(uint32_t down_ms, int attempts) {
+  if (down_ms >= RECOVERY_REBOOT_AFTER_MS && attempts >= RECOVERY_REBOOT_MIN_ATTEMPTS) {
+    return RecoveryAction::REBOOT;
+  }
+  if (down_ms >= RECOVERY_ERROR_AFTER_MS) {
+    return RecoveryAction::REPORT_ERROR;
+  }
+  return RecoveryAction::NONE;
+}
+
+void ConnectionMonitor::on_connected() {
+  uint32_t disconnected_at = disconnected_at_.exchange(0);
+  if (disconnected_at != 0) {
+    ESP_LOGI(TAG, "Reconnected after %u ms (attempts=%d)", static_cast<unsigned>(millis() - disconnected_at),
+             attempts_.load());
+  }
+  attempts_ = 0;
+}
+
+int ConnectionMonitor::on_disconnected() {
+  // 0 marks "connected", so an outage starting at millis() == 0 is counted from 1
+  uint32_t expected = 0;
+  disconnected_at_.compare_exchange_strong(expected, std::max<uint32_t>(millis(), 1));
+  return ++attempts_;
+}
+
+uint32_t ConnectionMonitor::get_down_ms() const {
+  uint32_t disconnected_at = disconnected_at_.load();
+  return disconnected_at != 0 ? millis() - disconnected_at : 0;
+}
+
+RecoveryAction ConnectionMonitor::check() const {
+  // Judged by time rather than attempt count, since reconnects back off
+  if (!is_down()) {
+    return RecoveryAction::NONE;
+  }
+  return recovery_action(get_down_ms(), get_attempts());
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
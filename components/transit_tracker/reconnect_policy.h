@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace transit_tracker {
+
+/// Reconnect delays that double from a base delay up to a cap, drawn from the upper
+/// half of each step so a fleet dropped by one server restart doesn't retry in lockstep.
+///
+/// esp_websocket_client copies its configured delay before it dispatches
+/// DISCONNECTED, so whatever is configured from that event only applies to the
+/// attempt after. on_connected() and on_disconnected() return the delay to
+/// configure to stay one attempt ahead; `random` supplies the jitter.
+class ReconnectBackoff {
+ public:
+  void set_base_delay_ms(uint32_t ms) { base_delay_ms_ = ms; }
+  void set_max_delay_ms(uint32_t ms) { max_delay_ms_ = ms; }
+
+  /// Call on start and once connected: the delay the first retry of the next outage waits.
+  uint32_t on_connected(uint32_t random) {
+    reset();
+    return next_delay_ms(random);
+  }
+  /// Call on every drop or failed attempt: the delay for the retry after the one just latched.
+  uint32_t on_disconnected(uint32_t random) { return next_delay_ms(random); }
+
+  /// Delay before the next attempt.
+  uint32_t next_delay_ms(uint32_t random);
+  void reset() { attempts_ = 0; }
+  int get_attempts() const { return attempts_; }
+
+ protected:
+  uint32_t base_delay_ms_{5000};
+  uint32_t max_delay_ms_{30000};
+  int attempts_{0};
+};
+
+/// How long the connection may stay down before the component reports an error,
+/// and before it reboots. Reboots also need a minimum number of failed attempts, so
+/// one attempt stuck in a long network timeout can't trigger one on its own.
+static constexpr uint32_t RECOVERY_ERROR_AFTER_MS = 15000;
+static constexpr uint32_t RECOVERY_REBOOT_AFTER_MS = 120000;
+static constexpr int RECOVERY_REBOOT_MIN_ATTEMPTS = 5;
+
+enum class RecoveryAction { NONE, REPORT_ERROR, REBOOT };
+
+/// What to do about a connection that has been down for `down_ms` over `attempts` failed attempts.
+RecoveryAction recovery_action(uint32_t down_ms, int attempts);
+
+/// Tracks how long the connection has been down, on millis(). Connection events
+/// come from the websocket task; check() runs in the main loop.
+class ConnectionMonitor {
+ public:
+  void on_connected();
+  /// Call on every drop or failed attempt. Returns the number in a row so far.
+  int on_disconnected();
+  /// recovery_action() for the outage in progress; NONE while connected.
+  RecoveryAction check() const;
+
+  bool is_down() const { return disconnected_at_.load() != 0; }
+  uint32_t get_down_ms() const;
+  int get_attempts() const { return attempts_.load(); }
+
+ protected:
+  std::atomic<uint32_t> disconnected_at_{0};  // millis() of the first drop; 0 while connected
+  std::atomic<int> attempts_{0};
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,253 @@
+#include "schedule_feed.h"
+#include "string_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *const TAG = "transit_tracker.feed";
+
+// Trips kept beyond `limit` so a row doesn't go blank while waiting for the next push
+static constexpr size_t SPARE_TRIPS = 2;
+
+std::vector<const char *> ScheduleFeed::requested_trip_fields() const {
+  // routeName/routeColor are still requested here; the server leaves them out
+  // for any route listed in styledRoutes since we override those locally
+  return {
+    "routeId", "routeName", "routeColor", "headsign", "isRealtime",
+    display_departure_times_ ? "departureTime" : "arrivalTime",
+  };
+}
+
+void ScheduleFeed::build_filter() {
+  // Only the fields the device actually renders are kept when deserializing;
+  // anything else the server sends is skipped by the parser without allocation.
+  filter_.clear();
+  filter_["event"] = true;
+
+  auto trip = filter_["data"]["trips"].add<JsonObject>();
+  for (const char *field : requested_trip_fields()) {
+    trip[field] = true;
+  }
+}
+
+void ScheduleFeed::on_message_start() {
+  // Also runs for messages the client ends up dropping, so one never leaks into the next
+  message_started_ms_ = millis();
+  partial_done_ = false;
+  partial_scanner_.reset(std::max(limit_, 0));
+}
+
+void ScheduleFeed::handle_message(const BulkString &payload) {
+  ESP_LOGV(TAG, "Received message (%u bytes): %s", static_cast<unsigned>(payload.size()), payload.c_str());
+
+  // Fast path: heartbeats and unknown events never need a JSON document
+  auto peeked_event = peek_event(payload.data(), payload.size());
+  if (peeked_event == "heartbeat") {
+    ESP_LOGD(TAG, "Received heartbeat");
+    if (on_heartbeat_) {
+      on_heartbeat_();
+    }
+    return;
+  }
+
+  bool is_dictionaries = peeked_event == "dictionaries";
+  if (!peeked_event.empty() && peeked_event != "schedule" && !is_dictionaries) {
+    ESP_LOGW(TAG, "Ignoring unknown event '%.*s' (%u bytes)", static_cast<int>(peeked_event.size()),
+             peeked_event.data(), static_cast<unsigned>(payload.size()));
+    return;
+  }
+
+  JsonDocument doc(BulkJsonAllocator::instance());
+  auto error = is_dictionaries
+                 ? deserializeJson(doc, payload.data(), payload.size())
+                 : deserializeJson(doc, payload.data(), payload.size(), DeserializationOption::Filter(filter_));
+  if (error) {
+    ESP_LOGW(TAG, "Failed to parse message (%u bytes, %s); preview: %.120s",
+             static_cast<unsigned>(payload.size()), error.c_str(), payload.c_str());
+    if (on_parse_error_) {
+      on_parse_error_();
+    }
+    return;
+  }
+
+  JsonObject root = doc.as<JsonObject>();
+  const char *event = root["event"] | "";
+
+  if (strcmp(event, "heartbeat") == 0) {
+    ESP_LOGD(TAG, "Received heartbeat");
+    if (on_heartbeat_) {
+      on_heartbeat_();
+    }
+    return;
+  }
+
+  if (strcmp(event, "dictionaries") == 0) {
+    if (on_dictionaries_) {
+      on_dictionaries_(root["data"], payload);
+    }
+    return;
+  }
+
+  if (strcmp(event, "schedule") != 0) {
+    ESP_LOGW(TAG, "Ignoring unknown event '%s' (%u bytes)", event, static_cast<unsigned>(payload.size()));
+    return;
+  }
+
+  ESP_LOGD(TAG, "Received schedule update (%u bytes)", static_cast<unsigned>(payload.size()));
+
+  publish_(build_trips_(root["data"]["trips"].as<JsonArray>()));
+
+  ESP_LOGD(TAG, "Schedule visible %u ms after first fragment arrived",
+           static_cast<unsigned>(millis() - message_started_ms_));
+}
+
+void ScheduleFeed::handle_partial_message(const BulkString &buffer) {
+  // At most once per message; on_message_start() resets this
+  if (partial_done_ || limit_ <= 0) {
+    return;
+  }
+
+  // Only the bytes added since the last fragment are scanned
+  partial_scanner_.scan(buffer.data(), buffer.size());
+  if (!partial_scanner_.has_event()) {
+    return;  // not received yet
+  }
+  if (partial_scanner_.event(buffer.data()) != "schedule") {
+    partial_done_ = true;
+    return;
+  }
+
+  // The server sends trips soonest first, so the leading ones are the rows that will be shown
+  auto scan = partial_scanner_.trips();
+  if (scan == TripScan::CLOSED) {
+    // a short list; the rest of the message is small and the full parse will cover it
+    partial_done_ = true;
+  }
+  if (scan != TripScan::FOUND) {
+    return;
+  }
+  partial_done_ = true;
+
+  const size_t array_start = partial_scanner_.array_start();
+  const size_t array_end = partial_scanner_.array_end();
+  BulkString trips_json(buffer.data() + array_start, array_end - array_start);
+  trips_json += ']';
+
+  JsonDocument doc(BulkJsonAllocator::instance());
+  auto error = deserializeJson(doc, trips_json.data(), trips_json.size(),
+                               DeserializationOption::Filter(filter_["data"]["trips"]));
+  if (error) {
+    ESP_LOGV(TAG, "Could not parse leading trips (%s); waiting for the full message", error.c_str());
+    return;
+  }
+
+  auto new_trips = build_trips_(doc.as<JsonArray>());
+  if (new_trips.empty()) {
+    return;
+  }
+
+  publish_(std::move(new_trips));
+
+  ESP_LOGD(TAG, "Showing first %d trips %u ms after first fragment (%u bytes received so far)", limit_,
+           static_cast<unsigned>(millis() - message_started_ms_), static_cast<unsigned>(buffer.size()));
+}
+
+void ScheduleFeed::publish_(BulkVector<Trip> &&trips) {
+  std::lock_guard<std::mutex> lock(state_.mutex);
+  state_.replace(std::move(trips));
+  if (on_published_) {
+    on_published_(state_.generation());
+  }
+}
+
+BulkVector<Trip> ScheduleFeed::build_trips_(JsonArray trip_array) {
+  const char *time_field = display_departure_times_ ? "departureTime" : "arrivalTime";
+
+  auto dictionaries = dictionaries_source_ ? dictionaries_source_() : nullptr;
+  if (dictionaries == nullptr) {
+    dictionaries = std::make_shared<const Dictionaries>();
+  }
+
+  // Rank trips by displayed time before materializing any strings, so a large
+  // schedule only costs allocations for the rows that can actually be shown
+  time_t now = clock_source_ ? clock_source_() : 0;
+  time_t cutoff = now != 0 ? now - STALE_TRIP_SECONDS : 0;
+
+  BulkVector<std::pair<time_t, JsonObject>> candidates;
+  candidates.reserve(trip_array.size());
+  for (JsonObject trip : trip_array) {
+    time_t display_time = trip[time_field].as<time_t>();
+    if (display_time >= cutoff) {
+      candidates.emplace_back(display_time, trip);
+    }
+  }
+
+  size_t keep = std::min(candidates.size(), static_cast<size_t>(std::max(limit_, 0)) + SPARE_TRIPS);
+  if (keep < candidates.size()) {
+    std::nth_element(candidates.begin(), candidates.begin() + keep, candidates.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+    ESP_LOGD(TAG, "Keeping %u of %u trips", static_cast<unsigned>(keep), static_cast<unsigned>(trip_array.size()));
+  }
+
+  BulkVector<Trip> new_trips;
+  new_trips.reserve(keep);
+
+  for (size_t i = 0; i < keep; i++) {
+    time_t display_time = candidates[i].first;
+    JsonObject trip = candidates[i].second;
+
+    BulkString headsign = trip["headsign"] | "";
+    for (const auto &abbr : dictionaries->abbreviations) {
+      size_t pos = headsign.find(abbr.first.data(), 0, abbr.first.size());
+      if (pos != BulkString::npos) {
+        ESP_LOGV(TAG, "Applying abbreviation '%s' -> '%s'", abbr.first.c_str(), abbr.second.c_str());
+        headsign.replace(pos, abbr.first.length(), abbr.second.data(), abbr.second.size());
+      }
+    }
+
+    const char *route_id = trip["routeId"] | "";
+    auto route_style = dictionaries->route_styles.find(route_id);
+
+    Color route_color = default_route_color_;
+    BulkString route_name;
+
+    if (route_style != dictionaries->route_styles.end()) {
+      route_color = route_style->second.color;
+      route_name = route_style->second.name.c_str();
+    } else {
+      route_name = trip["routeName"] | "";
+      if (!trip["routeColor"].isNull()) {
+        auto color_str = trip["routeColor"].as<std::string>();
+        uint32_t parsed_color;
+        if (parse_hex_color(color_str, parsed_color)) {
+          route_color = Color(parsed_color);
+        } else if (!color_str.empty()) {
+          ESP_LOGW(TAG, "Ignoring invalid routeColor '%s' for route %s", color_str.c_str(), route_id);
+        }
+      }
+    }
+
+    // Only the displayed timestamp is requested from the server; the other one stays 0
+    new_trips.push_back({
+      .route_id = route_id,
+      .route_name = std::move(route_name),
+      .route_color = route_color,
+      .headsign = std::move(headsign),
+      .arrival_time = display_departure_times_ ? 0 : display_time,
+      .departure_time = display_departure_times_ ? display_time : 0,
+      .is_realtime = trip["isRealtime"].as<bool>(),
+    });
+  }
+
+  return new_trips;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "esphome/core/color.h"
+#include "esphome/components/json/json_util.h"
+
+#include "dictionaries.h"
+#include "json_scan.h"
+#include "memory.h"
+#include "schedule_state.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+/// Turns the messages WebSocketClient delivers into trips in a ScheduleState:
+/// routes events, parses schedules (and the leading trips of one still streaming
+/// in) and publishes them. All handlers run on the websocket task.
+class ScheduleFeed {
+ public:
+  using DictionariesSource = std::function<std::shared_ptr<const Dictionaries>()>;
+  using ClockSource = std::function<time_t()>;
+  using DictionariesCallback = std::function<void(JsonObject data, const BulkString &payload)>;
+  using PublishCallback = std::function<void(uint32_t generation)>;
+  using EventCallback = std::function<void()>;
+
+  explicit ScheduleFeed(ScheduleState &state) : state_(state) {}
+
+  void set_limit(int limit) { limit_ = limit; }
+  void set_display_departure_times(bool display_departure_times) {
+    display_departure_times_ = display_departure_times;
+  }
+  void set_default_route_color(const Color &color) { default_route_color_ = color; }
+  /// Abbreviations and route styles applied to each trip
+  void set_dictionaries_source(DictionariesSource source) { dictionaries_source_ = std::move(source); }
+  /// Current unix time, or 0 while the clock isn't synced (nothing is treated as stale then)
+  void set_clock_source(ClockSource source) { clock_source_ = std::move(source); }
+
+  void set_on_heartbeat(EventCallback cb) { on_heartbeat_ = std::move(cb); }
+  void set_on_dictionaries(DictionariesCallback cb) { on_dictionaries_ = std::move(cb); }
+  void set_on_parse_error(EventCallback cb) { on_parse_error_ = std::move(cb); }
+  /// Called after trips are published, with the new generation, while still holding the schedule mutex.
+  void set_on_published(PublishCallback cb) { on_published_ = std::move(cb); }
+
+  /// Trip fields the subscribe asks for; everything else is skipped while parsing.
+  std::vector<const char *> requested_trip_fields() const;
+  /// Builds the parse filter from requested_trip_fields(). Call again after changing the time field.
+  void build_filter();
+
+  /// Hook up to WebSocketClient's message start, partial message and message callbacks.
+  void on_message_start();
+  void handle_partial_message(const BulkString &buffer);
+  void handle_message(const BulkString &payload);
+
+ protected:
+  BulkVector<Trip> build_trips_(JsonArray trip_array);
+  void publish_(BulkVector<Trip> &&trips);
+
+  ScheduleState &state_;
+  int limit_{0};
+  bool display_departure_times_{true};
+  Color default_route_color_{Color(0x028e51)};
+  DictionariesSource dictionaries_source_;
+  ClockSource clock_source_;
+
+  EventCallback on_heartbeat_;
+  DictionariesCallback on_dictionaries_;
+  EventCallback on_parse_error_;
+  PublishCallback on_published_;
+
+  JsonDocument filter_;
+
+  // The message still streaming in, reset as each one starts
+  LeadingTripScanner partial_scanner_;
+  bool partial_done_{false};  // its leading trips were shown, or can't be
+  uint32_t message_started_ms_{0};
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,276 @@
+#include "schedule_renderer.h"
+
+#include <algorithm>
+#include <climits>
+#include <mutex>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *const TAG = "transit_tracker.renderer";
+
+void ScheduleRenderer::draw_text_centered_(const char *text, Color color) {
+  int display_center_x = this->display_->get_width() / 2;
+  int display_center_y = this->display_->get_height() / 2;
+  this->display_->print(display_center_x, display_center_y, this->font_, color, display::TextAlign::CENTER, text);
+}
+
+void ScheduleRenderer::set_realtime_color(const Color &color) {
+  this->realtime_color_ = color;
+  this->realtime_color_dark_ = Color(
+    (color.r * 0.5),
+    (color.g * 0.5),
+    (color.b * 0.5)
+  );
+}
+
+const uint8_t realtime_icon[6][6] = {
+  {0, 0, 0, 3, 3, 3},
+  {0, 0, 3, 0, 0, 0},
+  {0, 3, 0, 0, 2, 2},
+  {3, 0, 0, 2, 0, 0},
+  {3, 0, 2, 0, 0, 1},
+  {3, 0, 2, 0, 1, 1}
+};
+
+void HOT ScheduleRenderer::draw_realtime_icon_(int bottom_right_x, int bottom_right_y, unsigned long uptime) {
+  const int num_frames = 6;
+  const int idle_frame_duration = 3000;
+  const int anim_frame_duration = 200;
+  const int cycle_duration = idle_frame_duration + (num_frames - 1) * anim_frame_duration;
+
+  unsigned long cycle_time = uptime % cycle_duration;
+
+  int frame;
+  if (cycle_time < idle_frame_duration) {
+    frame = 0;
+  } else {
+    frame = 1 + (cycle_time - idle_frame_duration) / anim_frame_duration;
+  }
+
+  auto is_segment_lit = [frame](uint8_t segment) {
+    switch (segment) {
+      case 1: return frame >= 1 && frame <= 3;
+      case 2: return frame >= 2 && frame <= 4;
+      case 3: return frame >= 3 && frame <= 5;
+      default: return false;
+    }
+  };
+
+  for (uint8_t i = 0; i < 6; ++i) {
+    for (uint8_t j = 0; j < 6; ++j) {
+      uint8_t segment_number = realtime_icon[i][j];
+      if (segment_number == 0) {
+        continue;
+      }
+
+      Color icon_color = is_segment_lit(segment_number) ? this->realtime_color_ : this->realtime_color_dark_;
+      this->display_->draw_pixel_at(bottom_right_x - (5 - j), bottom_right_y - (5 - i), icon_color);
+    }
+  }
+}
+
+void ScheduleRenderer::update_row_layouts_(ScheduleState::Range trips, uint32_t schedule_generation, uint rtc_now) {
+  size_t count = trips.end() - trips.begin();
+  bool rebuild = this->row_layouts_.size() != count || this->row_layouts_generation_ != schedule_generation ||
+                 this->row_layouts_revision_ != this->localization_.get_revision() ||
+                 rtc_now < this->row_layouts_updated_at_;  // clock stepped backwards
+
+  if (!rebuild && rtc_now < this->row_layouts_next_change_) {
+    return;
+  }
+
+  int _;
+  if (rebuild) {
+    this->row_layouts_.resize(count);
+    size_t i = 0;
+    for (const Trip &trip : trips) {
+      RowLayout &row = this->row_layouts_[i++];
+      this->font_->measure(trip.route_name.c_str(), &row.route_width, &_, &_, &_);
+      this->font_->measure(trip.headsign.c_str(), &row.headsign_width, &_, &_, &_);
+      row.time_text_valid_until = 0;
+    }
+
+    this->row_layouts_generation_ = schedule_generation;
+    this->row_layouts_revision_ = this->localization_.get_revision();
+  }
+
+  // Only rows whose countdown string has flipped since the last update are reformatted
+  this->row_layouts_next_change_ = UINT_MAX;
+  size_t i = 0;
+  for (const Trip &trip : trips) {
+    RowLayout &row = this->row_layouts_[i++];
+    if (rebuild || rtc_now >= row.time_text_valid_until) {
+      time_t display_time = this->display_time_(trip);
+      row.time_text = this->localization_.fmt_duration_from_now(display_time, rtc_now);
+      this->font_->measure(row.time_text.c_str(), &row.time_width, &_, &_, &_);
+      row.time_text_valid_until = this->localization_.next_change(display_time, rtc_now);
+    }
+    this->row_layouts_next_change_ = std::min(this->row_layouts_next_change_, row.time_text_valid_until);
+  }
+
+  this->row_layouts_updated_at_ = rtc_now;
+}
+
+void ScheduleRenderer::draw_trip(
+    const Trip &trip, const RowLayout &row, int y_offset, int font_height, unsigned long uptime,
+    bool no_draw, int *headsign_overflow_out, int scroll_cycle_duration
+) {
+  if (!no_draw) {
+    TT_PROFILE(PROFILE_STAGE_PRINT,
+      this->display_->print(0, y_offset, this->font_, trip.route_color, display::TextAlign::TOP_LEFT, trip.route_name.c_str()));
+  }
+
+  int headsign_clipping_start = row.route_width + 3;
+  int headsign_clipping_end = this->display_->get_width() - row.time_width - 2;
+
+  if (!no_draw) {
+    Color time_color = trip.is_realtime ? this->realtime_color_ : Color(0xa7a7a7);
+    TT_PROFILE(PROFILE_STAGE_PRINT,
+      this->display_->print(this->display_->get_width() + 1, y_offset, this->font_, time_color, display::TextAlign::TOP_RIGHT, row.time_text.c_str()));
+  }
+
+  if (trip.is_realtime) {
+    headsign_clipping_end -= 8;
+
+    if(!no_draw) {
+      int icon_bottom_right_x = this->display_->get_width() - row.time_width - 2;
+      int icon_bottom_right_y = y_offset + font_height - 6;
+
+      TT_PROFILE(PROFILE_STAGE_ICON, this->draw_realtime_icon_(icon_bottom_right_x, icon_bottom_right_y, uptime));
+    }
+  }
+
+  int headsign_max_width = headsign_clipping_end - headsign_clipping_start;
+
+  int headsign_overflow = row.headsign_width - headsign_max_width;
+  if (headsign_overflow_out) {
+    *headsign_overflow_out = headsign_overflow;
+  }
+
+  if (no_draw) {
+    return;
+  }
+
+  int scroll_offset = 0;
+  if (headsign_overflow > 0 && scroll_cycle_duration > 0) {
+    /// Note: The scroll may jump if headsign_clipping_end changes (e.g. due to the width of the arrival time changing).
+    /// This is probably not a big deal, since the display makes sudden changes anyway (e.g. when routes are updated)
+    /// and this happens relatively infrequently.
+
+    int scroll_time = headsign_overflow * 1000 / scroll_speed;
+    int scroll_cycle_time = uptime % scroll_cycle_duration;
+
+    // Scroll idle (left side - default)
+    if(scroll_cycle_time < idle_time_left) {
+      // scroll_offset = 0; do nothing
+    } else if (scroll_cycle_time < idle_time_left + scroll_time) {
+      // Scrolling left
+      int time_since_scroll_start = scroll_cycle_time - idle_time_left;
+      scroll_offset = time_since_scroll_start * scroll_speed / 1000;
+    } else if (scroll_cycle_time < idle_time_left + scroll_time + idle_time_right) {
+      // Scroll idle (right side)
+      scroll_offset = headsign_overflow;
+    } else if (scroll_cycle_time < idle_time_left + 2 * scroll_time + idle_time_right){
+      // Scrolling right
+      int time_since_scroll_start = scroll_cycle_time - (idle_time_left + scroll_time + idle_time_right);
+      scroll_offset = headsign_overflow - (time_since_scroll_start * scroll_speed / 1000);
+    } else {
+      // Waiting for other headsigns to finish scrolling
+      // scroll_offset = 0; do nothing
+    }
+  }
+
+  TT_PROFILE(PROFILE_STAGE_CLIP,
+    this->display_->start_clipping(headsign_clipping_start, 0, headsign_clipping_end, this->display_->get_height()));
+  TT_PROFILE(PROFILE_STAGE_PRINT,
+    this->display_->print(headsign_clipping_start - scroll_offset, y_offset, this->font_, trip.headsign.c_str()));
+  TT_PROFILE(PROFILE_STAGE_CLIP, this->display_->end_clipping());
+}
+
+void HOT ScheduleRenderer::draw(unsigned long uptime, uint rtc_now, uint32_t status) {
+  TT_PROFILE_SCOPE(PROFILE_STAGE_FRAME);
+
+  if (this->display_ == nullptr) {
+    ESP_LOGW(TAG, "No display attached, cannot draw schedule");
+    return;
+  }
+
+  if (!(status & RENDER_STATE_NETWORK_UP)) {
+    this->draw_text_centered_("Waiting for network", Color(0x252627));
+    return;
+  }
+
+  if (!(status & RENDER_STATE_TIME_VALID)) {
+    this->draw_text_centered_("Waiting for time sync", Color(0x252627));
+    return;
+  }
+
+  if (!this->has_base_url_) {
+    this->draw_text_centered_("No base URL set", Color(0x252627));
+    return;
+  }
+
+  if (status & RENDER_STATE_ERROR) {
+    this->draw_text_centered_("Error loading schedule", Color(0xFE4C5C));
+    return;
+  }
+
+  if (!(status & RENDER_STATE_CONNECTED_EVER)) {
+    this->draw_text_centered_("Loading...", Color(0x252627));
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(this->schedule_state_.mutex, std::defer_lock);
+  TT_PROFILE(PROFILE_STAGE_LOCK, lock.lock());
+
+  if (this->schedule_state_.empty()) {
+    auto message = this->display_departure_times_ ? "No upcoming departures" : "No upcoming arrivals";
+    this->draw_text_centered_(message, Color(0x252627));
+    return;
+  }
+
+  int nominal_font_height = this->font_->get_ascender() + this->font_->get_descender();
+
+  auto visible_trips = this->schedule_state_.visible(this->limit_);
+  TT_PROFILE(PROFILE_STAGE_LAYOUT,
+    this->update_row_layouts_(visible_trips, this->schedule_state_.generation(), rtc_now));
+
+  int scroll_cycle_duration = 0;
+  if (this->scroll_headsigns_) {
+    int largest_headsign_overflow = 0;
+    size_t row = 0;
+    for (const Trip &trip : visible_trips) {
+      int headsign_overflow;
+      this->draw_trip(trip, this->row_layouts_[row++], 0, nominal_font_height, uptime, true, &headsign_overflow);
+      largest_headsign_overflow = std::max(largest_headsign_overflow, headsign_overflow);
+    }
+
+    if (largest_headsign_overflow > 0) {
+      int longest_scroll_time = largest_headsign_overflow * 1000 / scroll_speed;
+      scroll_cycle_duration = idle_time_left + idle_time_right + 2*longest_scroll_time;
+    }
+  }
+
+  int max_trips_height = (this->limit_ * this->font_->get_ascender()) + ((this->limit_ - 1) * this->font_->get_descender());
+  int y_offset = (this->display_->get_height() % max_trips_height) / 2;
+
+  bool has_header_text = !this->header_text_.empty();
+  if (has_header_text) {
+    TT_PROFILE(PROFILE_STAGE_PRINT,
+      this->display_->print(0, y_offset, this->font_, Color(0x00bdbd), display::TextAlign::LEFT, this->header_text_.c_str()));
+    y_offset += nominal_font_height;
+  }
+
+  size_t row = 0;
+  for (const Trip &trip : visible_trips) {
+    this->draw_trip(trip, this->row_layouts_[row++], y_offset, nominal_font_height, uptime, false, nullptr, scroll_cycle_duration);
+    y_offset += nominal_font_height;
+  }
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
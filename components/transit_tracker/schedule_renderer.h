@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esphome/core/color.h"
+#include "esphome/components/display/display.h"
+#include "esphome/components/font/font.h"
+
+#include "frame_profiler.h"
+#include "localization.h"
+#include "schedule_state.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+/// Cached text and measurements for one visible schedule row
+struct RowLayout {
+  std::string time_text;
+  int time_width;
+  int route_width;
+  int headsign_width;
+  uint time_text_valid_until;  // RTC time at which time_text next changes
+};
+
+/// Bits of TransitTracker's render state word. The schedule generation occupies the bits above the flags.
+enum RenderStateFlag : uint32_t {
+  RENDER_STATE_NETWORK_UP = 1 << 0,
+  RENDER_STATE_TIME_VALID = 1 << 1,
+  RENDER_STATE_ERROR = 1 << 2,
+  RENDER_STATE_CONNECTED_EVER = 1 << 3,
+  RENDER_STATE_FLAGS_MASK = 0xFF,
+};
+static constexpr int RENDER_STATE_GENERATION_SHIFT = 8;
+
+/// Draws the schedule, or a status message while there is none, onto a display. Every
+/// input that changes over time is passed to draw(), so it builds and runs on the host.
+class ScheduleRenderer {
+  public:
+    ScheduleRenderer(ScheduleState &schedule_state, const Localization &localization)
+        : schedule_state_(schedule_state), localization_(localization) {}
+
+    /// Draws the frame for the given animation clock (ms, drives scrolling and the realtime
+    /// icon), wall-clock time (drives countdowns) and connection status (RENDER_STATE_* flags).
+    /// For a given schedule, the same arguments draw the same frame.
+    void draw(unsigned long uptime, uint rtc_now, uint32_t status);
+
+#ifdef USE_TRANSIT_TRACKER_PROFILER
+    /// Logs per-stage draw timings collected since boot.
+    void dump_frame_profile() const { this->profiler_.dump("transit_tracker.profiler"); }
+#endif
+
+    void set_display(display::Display *display) { this->display_ = display; }
+    void set_font(font::Font *font) { this->font_ = font; }
+    void set_limit(int limit) { this->limit_ = limit; }
+    void set_scroll_headsigns(bool scroll_headsigns) { this->scroll_headsigns_ = scroll_headsigns; }
+    bool get_scroll_headsigns() const { return this->scroll_headsigns_; }
+    void set_header_text(const std::string &header_text) { this->header_text_ = header_text; }
+    void set_display_departure_times(bool display_departure_times) {
+      this->display_departure_times_ = display_departure_times;
+    }
+    /// Without a base URL there is nothing to connect to, which draw() reports once network and time are up.
+    void set_has_base_url(bool has_base_url) { this->has_base_url_ = has_base_url; }
+    void set_realtime_color(const Color &color);
+
+  protected:
+    static constexpr int scroll_speed = 10; // pixels/second
+    static constexpr int idle_time_left = 5000;
+    static constexpr int idle_time_right = 1000;
+
+    void draw_text_centered_(const char *text, Color color);
+    void draw_realtime_icon_(int bottom_right_x, int bottom_right_y, unsigned long now);
+
+    time_t display_time_(const Trip &trip) const { return this->schedule_state_.sort_time(trip); }
+
+    void update_row_layouts_(ScheduleState::Range trips, uint32_t schedule_generation, uint rtc_now);
+    void draw_trip(
+      const Trip &trip, const RowLayout &row, int y_offset, int font_height, unsigned long uptime,
+      bool no_draw = false, int *headsign_overflow_out = nullptr, int scroll_cycle_duration = 0
+    );
+
+    ScheduleState &schedule_state_;
+    const Localization &localization_;
+
+#ifdef USE_TRANSIT_TRACKER_PROFILER
+    FrameProfiler profiler_;
+#endif
+
+    // Only touched from draw() while holding the schedule mutex
+    std::vector<RowLayout> row_layouts_;
+    uint32_t row_layouts_generation_ = 0;
+    uint32_t row_layouts_revision_ = 0;
+    uint row_layouts_updated_at_ = 0;
+    uint row_layouts_next_change_ = 0;
+
+    display::Display *display_ = nullptr;
+    font::Font *font_ = nullptr;
+
+    int limit_ = 0;
+    bool scroll_headsigns_ = false;
+    bool display_departure_times_ = true;
+    bool has_base_url_ = false;
+    std::string header_text_;
+
+    Color realtime_color_ = Color(0x20FF00);
+    Color realtime_color_dark_ = Color(0x00A700);
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,29 @@
+#include "schedule_state.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+void ScheduleState::replace(BulkVector<Trip> &&trips) {
+  this->trips_ = std::move(trips);
+  // The server already sends trips in order, so this is usually a no-op pass
+  std::stable_sort(this->trips_.begin(), this->trips_.end(), [this](const Trip &a, const Trip &b) {
+    return this->sort_time(a) < this->sort_time(b);
+  });
+  this->generation_++;
+}
+
+size_t ScheduleState::expire_before(time_t cutoff) {
+  auto first_kept = std::partition_point(this->trips_.cbegin(), this->trips_.cend(), [this, cutoff](const Trip &trip) {
+    return this->sort_time(trip) < cutoff;
+  });
+
+  size_t removed = first_kept - this->trips_.cbegin();
+  if (removed > 0) {
+    this->trips_.erase(this->trips_.cbegin(), first_kept);
+    this->generation_++;
+  }
+  return removed;
+}
+
+} // namespace transit_tracker
+} // namespace esphome
@@ -1,29 +1,69 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <ctime>
 #include <mutex>
 
-#include "esphome/components/display/display.h"
+#include "esphome/core/color.h"
+
+#include "memory.h"
 
 namespace esphome {
 namespace transit_tracker {
 
+/// How long after its displayed time a trip stays on the display before it's dropped as departed.
+static constexpr int STALE_TRIP_SECONDS = 60;
+
 class Trip {
   public:
-    std::string route_id;
-    std::string route_name;
+    BulkString route_id;
+    BulkString route_name;
     Color route_color;
-    std::string headsign;
+    BulkString headsign;
     time_t arrival_time;
     time_t departure_time;
     bool is_realtime;
 };
 
+/// Trips ordered by the timestamp shown on the display (departure or arrival),
+/// soonest first. Callers must hold `mutex` while reading or modifying.
 class ScheduleState {
   public:
+    using const_iterator = BulkVector<Trip>::const_iterator;
+
+    struct Range {
+      const_iterator first;
+      const_iterator last;
+
+      const_iterator begin() const { return first; }
+      const_iterator end() const { return last; }
+    };
+
     std::mutex mutex;
-    std::vector<Trip> trips;
+
+    void set_sort_by_departure(bool sort_by_departure) { sort_by_departure_ = sort_by_departure; }
+    time_t sort_time(const Trip &trip) const { return sort_by_departure_ ? trip.departure_time : trip.arrival_time; }
+
+    /// Replaces every trip, sorting the new set by displayed time.
+    void replace(BulkVector<Trip> &&trips);
+    /// Drops trips from the front whose displayed time is before `cutoff`. Returns how many were removed.
+    size_t expire_before(time_t cutoff);
+
+    bool empty() const { return trips_.empty(); }
+    const Trip &front() const { return trips_.front(); }
+    /// Incremented on every change to the trip list.
+    uint32_t generation() const { return generation_; }
+
+    /// The first `limit` trips; these are the rows that fit on the display.
+    Range visible(size_t limit) const {
+      return {trips_.begin(), trips_.begin() + std::min(limit, trips_.size())};
+    }
+
+  protected:
+    bool sort_by_departure_ = true;
+    BulkVector<Trip> trips_;
+    uint32_t generation_ = 0;
 };
 
 } // namespace transit_tracker
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
@@ -1,12 +1,53 @@
 #include "string_utils.h"
-#include <sstream>
 
-std::vector<std::string> split(const std::string &s, char delim) {
-  std::vector<std::string> elems;
-  std::stringstream ss(s);
-  std::string item;
-  while (std::getline(ss, item, delim)) {
-    elems.push_back(item);
+bool Tokenizer::next(std::string_view &token) {
+  if (pos_ >= text_.size()) {
+    return false;
   }
-  return elems;
-}
\ No newline at end of file
+
+  size_t end = text_.find(delim_, pos_);
+  if (end == std::string_view::npos) {
+    end = text_.size();
+  }
+
+  token = text_.substr(pos_, end - pos_);
+  pos_ = end + 1;
+  return true;
+}
+
+size_t split_fields(std::string_view text, char delim, std::string_view *fields, size_t max_fields) {
+  Tokenizer tokenizer(text, delim);
+  std::string_view field;
+  size_t count = 0;
+  while (tokenizer.next(field)) {
+    if (count < max_fields) {
+      fields[count] = field;
+    }
+    count++;
+  }
+  return count;
+}
+
+bool parse_hex_color(std::string_view str, uint32_t &out) {
+  // Exactly what we send and store: 1-6 hex digits, no sign, prefix or whitespace
+  // (strtoul alone would accept " -0x1" and values wider than 24 bits)
+  if (str.empty() || str.size() > 6) {
+    return false;
+  }
+  uint32_t value = 0;
+  for (char c : str) {
+    uint32_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    value = (value << 4) | digit;
+  }
+  out = value;
+  return true;
+}
@@ -1,6 +1,26 @@
 #pragma once
 
-#include <string>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
-std::vector<std::string> split(const std::string &s, char delim);
+/// Iterates over the pieces of `text` separated by `delim` without copying. Like
+/// std::getline, a trailing delimiter does not produce an empty final piece.
+class Tokenizer {
+  public:
+    Tokenizer(std::string_view text, char delim) : text_(text), delim_(delim) {}
+
+    bool next(std::string_view &token);
+
+  protected:
+    std::string_view text_;
+    char delim_;
+    size_t pos_ = 0;
+};
+
+/// Splits `text` into at most `max_fields` views. Returns the total number of
+/// fields, which may be larger than `max_fields`.
+size_t split_fields(std::string_view text, char delim, std::string_view *fields, size_t max_fields);
+
+/// Parses a route color as sent by the server: 1-6 hex digits, nothing else.
+bool parse_hex_color(std::string_view str, uint32_t &out);
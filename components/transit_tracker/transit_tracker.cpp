@@ -1,7 +1,10 @@
 #include "transit_tracker.h"
 #include "string_utils.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <string_view>
 #include <strings.h>
 
 #include "esp_heap_caps.h"
@@ -18,10 +21,9 @@ namespace transit_tracker {
 
 static const char *const TAG = "transit_tracker.component";
 
-static constexpr int CONNECT_FAILURE_ERROR_THRESHOLD = 3;
-static constexpr int CONNECT_FAILURE_REBOOT_THRESHOLD = 15;
 static constexpr unsigned long HEARTBEAT_TIMEOUT_MS = 60000;
-static constexpr int STALE_TRIP_SECONDS = 60;
+static constexpr size_t IMPORT_LINES_PER_LOOP = 16;
+static constexpr unsigned long IDLE_CHECK_INTERVAL_MS = 1000;
 
 static std::string compute_device_id() {
   uint8_t mac[6];
@@ -35,30 +37,36 @@ static std::string compute_device_id() {
   return std::string(hex);
 }
 
-static bool parse_hex_color(const std::string &str, uint32_t &out) {
-  if (str.empty()) {
-    return false;
-  }
-  char *end = nullptr;
-  unsigned long value = std::strtoul(str.c_str(), &end, 16);
-  if (end == str.c_str() || *end != '\0') {
-    return false;
-  }
-  out = static_cast<uint32_t>(value);
-  return true;
-}
-
 void TransitTracker::setup() {
-  this->ws_client_.set_on_message([this](const std::string &payload) {
-    this->handle_message_(payload);
+  this->feed_.build_filter();
+  this->feed_.set_dictionaries_source([this]() { return this->get_dictionaries_(); });
+  this->feed_.set_clock_source([this]() -> time_t {
+    auto now = this->rtc_->now();
+    return now.is_valid() ? now.timestamp : 0;
+  });
+  this->feed_.set_on_heartbeat([this]() { this->last_heartbeat_ = millis(); });
+  this->feed_.set_on_dictionaries([this](JsonObject data, const BulkString &payload) {
+    this->handle_dictionaries_(data, payload);
   });
+  this->feed_.set_on_parse_error([this]() { this->status_set_error(LOG_STR("Failed to parse schedule data")); });
+  this->feed_.set_on_published([this](uint32_t generation) { this->publish_schedule_generation_(generation); });
+
+  this->load_cached_dictionaries_();
+  this->rebuild_dictionaries_();
+
+  this->ws_client_.set_on_message([this](const BulkString &payload) { this->feed_.handle_message(payload); });
+  this->ws_client_.set_on_partial_message([this](const BulkString &buffer) {
+    this->feed_.handle_partial_message(buffer);
+  });
+  this->ws_client_.set_on_message_start([this]() { this->feed_.on_message_start(); });
 
   this->ws_client_.set_on_connected([this]() {
-    // defer the actual subscribe send and status update to loop()
+    this->connection_monitor_.on_connected();
+
+    // The subscribe was already sent by the websocket client; defer the status update to loop()
     this->last_heartbeat_ = millis();
-    this->has_ever_connected_ = true;
-    this->consecutive_disconnects_ = 0;
-    this->pending_subscribe_ = true;
+    this->render_state_.fetch_or(RENDER_STATE_CONNECTED_EVER);
+    this->pending_clear_error_ = true;
   });
 
   this->ws_client_.set_on_disconnected([this]() {
@@ -108,55 +116,187 @@ void TransitTracker::setup() {
   }
 
   this->set_interval("check_stale_trips", 10000, [this]() {
-    if (!this->ws_client_.is_connected()) {
-      return;
-    }
-
     auto now = this->rtc_->now();
     if (!now.is_valid()) {
       return;
     }
 
-    bool has_stale_trips = false;
+    // Trips are sorted by displayed time, so departed ones are always at the front
+    size_t expired;
     {
       std::lock_guard<std::mutex> lock(this->schedule_state_.mutex);
-      for (const auto &trip : this->schedule_state_.trips) {
-        if (now.timestamp - trip.departure_time > STALE_TRIP_SECONDS) {
-          has_stale_trips = true;
-          break;
-        }
+      expired = this->schedule_state_.expire_before(now.timestamp - STALE_TRIP_SECONDS);
+      if (expired > 0) {
+        this->publish_schedule_generation_(this->schedule_state_.generation());
       }
     }
 
-    if (has_stale_trips) {
-      ESP_LOGW(TAG, "Stale trips detected (rtc=%d, last_heartbeat=%lu, uptime=%lu)",
-               now.timestamp, this->last_heartbeat_.load(), millis());
+    if (expired > 0) {
+      ESP_LOGW(TAG, "Expired %u stale trips (rtc=%d, last_heartbeat=%lu, uptime=%lu)",
+               static_cast<unsigned>(expired), now.timestamp, this->last_heartbeat_.load(), millis());
     }
   });
 }
 
 void TransitTracker::loop() {
-  if (this->pending_subscribe_.exchange(false)) {
+  // Large text blobs are imported a few lines at a time so the loop never stalls
+  if (this->abbreviation_import_) {
+    this->step_abbreviation_import_();
+  }
+
+  if (this->route_style_import_) {
+    this->step_route_style_import_();
+  }
+
+  if (this->has_pending_dictionaries_.exchange(false)) {
+    this->install_pending_dictionaries_();
+  }
+
+  if (this->dictionaries_dirty_) {
+    this->rebuild_dictionaries_();
+  }
+
+  this->check_connection_recovery_();
+
+  if (this->pending_clear_error_.exchange(false)) {
     this->status_clear_error();
-    this->send_subscribe_();
   }
 
+  this->update_render_state_();
+
+  // A heartbeat can't arrive while a large message is still streaming in ahead of it
   unsigned long heartbeat = this->last_heartbeat_.load();
-  if (heartbeat != 0 && millis() - heartbeat > HEARTBEAT_TIMEOUT_MS) {
+  if (heartbeat != 0 && millis() - heartbeat > HEARTBEAT_TIMEOUT_MS && !this->ws_client_.is_receiving()) {
     ESP_LOGW(TAG, "No heartbeat for %lu ms (last_heartbeat=%lu, uptime=%lu)",
              millis() - heartbeat, heartbeat, millis());
     this->last_heartbeat_ = 0;
   }
+
+  this->update_idle_state_();
+}
+
+void TransitTracker::update_render_state_() {
+  uint32_t flags = this->render_state_.load() & RENDER_STATE_TIME_VALID;
+
+  if (esphome::network::is_connected()) {
+    flags |= RENDER_STATE_NETWORK_UP;
+  }
+  // Once the clock is synced it stays valid, so only convert it until then
+  if (!(flags & RENDER_STATE_TIME_VALID) && this->rtc_->now().is_valid()) {
+    flags |= RENDER_STATE_TIME_VALID;
+  }
+  if (this->status_has_error()) {
+    flags |= RENDER_STATE_ERROR;
+  }
+
+  const uint32_t mask = RENDER_STATE_NETWORK_UP | RENDER_STATE_TIME_VALID | RENDER_STATE_ERROR;
+  uint32_t state = this->render_state_.load();
+  while (!this->render_state_.compare_exchange_weak(state, (state & ~mask) | flags)) {
+  }
+}
+
+void TransitTracker::publish_schedule_generation_(uint32_t generation) {
+  uint32_t state = this->render_state_.load();
+  while (!this->render_state_.compare_exchange_weak(
+      state, (state & RENDER_STATE_FLAGS_MASK) | (generation << RENDER_STATE_GENERATION_SHIFT))) {
+  }
+}
+
+void TransitTracker::update_idle_state_() {
+  if (!this->idle_enabled_) {
+    return;
+  }
+
+  // Status screens and new schedules shouldn't wait for the slow idle refresh
+  uint32_t render_state = this->render_state_.load();
+  if (this->idle_ && render_state != this->idle_render_state_ && this->display_ != nullptr) {
+    this->display_->update();
+  }
+  this->idle_render_state_ = render_state;
+
+  if (millis() - this->last_idle_check_ < IDLE_CHECK_INTERVAL_MS) {
+    return;
+  }
+  this->last_idle_check_ = millis();
+
+  auto now = this->rtc_->now();
+  if (!now.is_valid()) {
+    return;
+  }
+
+  bool quiet = false;
+  if (this->quiet_hours_start_ >= 0) {
+    if (this->quiet_hours_start_ <= this->quiet_hours_end_) {
+      quiet = now.hour >= this->quiet_hours_start_ && now.hour < this->quiet_hours_end_;
+    } else {
+      // wraps past midnight, e.g. 23 -> 5
+      quiet = now.hour >= this->quiet_hours_start_ || now.hour < this->quiet_hours_end_;
+    }
+  }
+
+  bool idle;
+  {
+    std::lock_guard<std::mutex> lock(this->schedule_state_.mutex);
+    // Until the first schedule arrives the loading screen keeps animating at the normal rate
+    bool received = this->schedule_state_.generation() != 0;
+    idle = quiet || (received && (this->schedule_state_.empty() ||
+                                  this->display_time_(this->schedule_state_.front()) - now.timestamp >
+                                      (time_t) this->idle_threshold_s_));
+  }
+
+  if (idle != this->idle_) {
+    this->set_idle_(idle);
+  }
+}
+
+void TransitTracker::set_idle_(bool idle) {
+  this->idle_ = idle;
+  ESP_LOGI(TAG, "%s low-activity mode", idle ? "Entering" : "Leaving");
+
+  if (this->display_ != nullptr) {
+    if (idle) {
+      this->active_update_interval_ms_ = this->display_->get_update_interval();
+      this->display_->set_update_interval(this->idle_update_interval_ms_);
+    } else {
+      this->display_->set_update_interval(this->active_update_interval_ms_);
+    }
+    this->display_->start_poller();
+    // Render the new mode's frame right away instead of waiting for the next poll
+    this->display_->update();
+  }
+
+  if (this->idle_ping_interval_s_ > 0) {
+    if (idle) {
+      this->active_ping_interval_s_ = this->ws_client_.get_ping_interval_sec();
+      this->ws_client_.set_ping_interval_sec(this->idle_ping_interval_s_);
+    } else {
+      this->ws_client_.set_ping_interval_sec(this->active_ping_interval_s_);
+    }
+  }
+
+  this->idle_callback_.call(idle);
 }
 
 void TransitTracker::dump_config() {
   ESP_LOGCONFIG(TAG, "Transit Tracker:");
   ESP_LOGCONFIG(TAG, "  Base URL: %s", this->base_url_.c_str());
-  ESP_LOGCONFIG(TAG, "  Schedule: %s", this->schedule_string_.c_str());
+  ESP_LOGCONFIG(TAG, "  Schedule (%s): %s", this->grouped_schedule_ ? "grouped" : "pairs",
+                this->schedule_string_.c_str());
   ESP_LOGCONFIG(TAG, "  Limit: %d", this->limit_);
   ESP_LOGCONFIG(TAG, "  List mode: %s", this->list_mode_.c_str());
   ESP_LOGCONFIG(TAG, "  Display departure times: %s", this->display_departure_times_ ? "true" : "false");
-  ESP_LOGCONFIG(TAG, "  Scroll Headsigns: %s", this->scroll_headsigns_ ? "true" : "false");
+  ESP_LOGCONFIG(TAG, "  Scroll Headsigns: %s", this->renderer_.get_scroll_headsigns() ? "true" : "false");
+  if (this->idle_enabled_) {
+    ESP_LOGCONFIG(TAG, "  Low-activity mode: after %us without trips, %ums refresh",
+                  static_cast<unsigned>(this->idle_threshold_s_), static_cast<unsigned>(this->idle_update_interval_ms_));
+    if (this->quiet_hours_start_ >= 0) {
+      ESP_LOGCONFIG(TAG, "  Quiet hours: %02d:00-%02d:00", this->quiet_hours_start_, this->quiet_hours_end_);
+    }
+  }
+  ESP_LOGCONFIG(TAG, "  Memory placement: %s",
+                get_bulk_memory_placement() == MEMORY_PLACEMENT_PSRAM ? "psram" : "internal");
+  ESP_LOGCONFIG(TAG, "  Compression: %s", this->ws_client_.is_compression_enabled() ? "permessage-deflate" : "none");
+  log_heap_stats(TAG);
 }
 
 void TransitTracker::reconnect(const char *reason) {
@@ -171,6 +311,8 @@ void TransitTracker::reconnect(const char *reason) {
   if (this->base_url_.empty()) {
     ESP_LOGW(TAG, "Base URL is not set - cannot reconnect");
   } else {
+    // pick up any schedule changes made since the last connect
+    this->update_subscribe_message_();
     this->ws_client_.set_uri(this->base_url_); 
     this->ws_client_.start();
   }
@@ -193,23 +335,39 @@ void TransitTracker::on_disconnect_() {
     return;
   }
 
-  int attempts = ++this->consecutive_disconnects_;
+  int attempts = this->connection_monitor_.on_disconnected();
   ESP_LOGW(TAG, "Websocket disconnected (consecutive=%d, network_connected=%s, free_heap=%u)",
            attempts, esphome::network::is_connected() ? "yes" : "no",
            static_cast<unsigned>(esp_get_free_heap_size()));
+  ESP_LOGD(TAG, "Received %u bytes on the wire (%u bytes decompressed)",
+           static_cast<unsigned>(this->ws_client_.get_wire_bytes()),
+           static_cast<unsigned>(this->ws_client_.get_message_bytes()));
+  log_heap_stats(TAG);
+}
 
-  if (attempts >= CONNECT_FAILURE_ERROR_THRESHOLD) {
-    this->status_set_error(LOG_STR("Failed to connect to WebSocket server"));
+void TransitTracker::check_connection_recovery_() {
+  if (this->fully_closed_) {
+    return;
   }
 
-  if (attempts >= CONNECT_FAILURE_REBOOT_THRESHOLD) {
-    ESP_LOGE(TAG, "Could not connect to WebSocket server within %d attempts; rebooting to recover",
-             CONNECT_FAILURE_REBOOT_THRESHOLD);
-    App.reboot();
+  switch (this->connection_monitor_.check()) {
+    case RecoveryAction::REBOOT:
+      ESP_LOGE(TAG, "Could not connect to WebSocket server for %u ms (%d attempts); rebooting to recover",
+               static_cast<unsigned>(this->connection_monitor_.get_down_ms()),
+               this->connection_monitor_.get_attempts());
+      App.reboot();
+      break;
+    case RecoveryAction::REPORT_ERROR:
+      if (!this->status_has_error()) {
+        this->status_set_error(LOG_STR("Failed to connect to WebSocket server"));
+      }
+      break;
+    case RecoveryAction::NONE:
+      break;
   }
 }
 
-void TransitTracker::send_subscribe_() {
+void TransitTracker::update_subscribe_message_() {
   auto message = json::build_json([this](JsonObject root) {
     root["event"] = "schedule:subscribe";
 
@@ -217,356 +375,250 @@ void TransitTracker::send_subscribe_() {
     if (!this->feed_code_.empty()) {
       data["feedCode"] = this->feed_code_;
     }
-    data["routeStopPairs"] = this->schedule_string_;
+    data[this->grouped_schedule_ ? "stopRoutes" : "routeStopPairs"] = this->schedule_string_;
     data["limit"] = this->limit_;
     data["sortByDeparture"] = this->display_departure_times_;
     data["listMode"] = this->list_mode_;
-  });
-
-  ESP_LOGD(TAG, "Subscribing (%u bytes)", static_cast<unsigned>(message.size()));
-  ESP_LOGV(TAG, "Subscribe payload: %s", message.c_str());
-  if (!this->ws_client_.send_text(message)) {
-    ESP_LOGW(TAG, "Subscribe send failed");
-  }
-}
 
-void TransitTracker::handle_message_(const std::string &payload) {
-  ESP_LOGV(TAG, "Received message (%u bytes): %s", static_cast<unsigned>(payload.size()), payload.c_str());
-
-  bool valid = json::parse_json(payload, [this, &payload](JsonObject root) -> bool {
-    auto event = root["event"].as<std::string>();
-
-    if (event == "heartbeat") {
-      ESP_LOGD(TAG, "Received heartbeat");
-      this->last_heartbeat_ = millis();
-      return true;
-    }
-
-    if (event != "schedule") {
-      ESP_LOGW(TAG, "Ignoring unknown event '%s' (%u bytes)", event.c_str(),
-               static_cast<unsigned>(payload.size()));
-      return true;
+    auto fields = data["fields"].to<JsonArray>();
+    for (const char *field : this->feed_.requested_trip_fields()) {
+      fields.add(field);
     }
 
-    ESP_LOGD(TAG, "Received schedule update (%u bytes)", static_cast<unsigned>(payload.size()));
-
-    std::vector<Trip> new_trips;
-    auto data = root["data"].as<JsonObject>();
-    auto trip_array = data["trips"].as<JsonArray>();
-    new_trips.reserve(trip_array.size());
-
-    for (auto trip : trip_array) {
-      std::string headsign = trip["headsign"].as<std::string>();
-      for (const auto &abbr : this->abbreviations_) {
-        size_t pos = headsign.find(abbr.first);
-        if (pos != std::string::npos) {
-          ESP_LOGV(TAG, "Applying abbreviation '%s' -> '%s'", abbr.first.c_str(), abbr.second.c_str());
-          headsign.replace(pos, abbr.first.length(), abbr.second);
-        }
-      }
-
-      auto route_id = trip["routeId"].as<std::string>();
-      auto route_style = this->route_styles_.find(route_id);
-
-      Color route_color = this->default_route_color_;
-      std::string route_name = trip["routeName"].as<std::string>();
-
-      if (route_style != this->route_styles_.end()) {
-        route_color = route_style->second.color;
-        route_name = route_style->second.name;
-      } else if (!trip["routeColor"].isNull()) {
-        auto color_str = trip["routeColor"].as<std::string>();
-        uint32_t parsed_color;
-        if (parse_hex_color(color_str, parsed_color)) {
-          route_color = Color(parsed_color);
-        } else if (!color_str.empty()) {
-          ESP_LOGW(TAG, "Ignoring invalid routeColor '%s' for route %s",
-                   color_str.c_str(), route_id.c_str());
-        }
+    auto dictionaries = this->get_dictionaries_();
+    if (!dictionaries->route_styles.empty()) {
+      // Let the server omit routeName/routeColor for routes we override locally
+      auto styled_routes = data["styledRoutes"].to<JsonArray>();
+      for (const auto &style : dictionaries->route_styles) {
+        styled_routes.add(style.first);
       }
-
-      new_trips.push_back({
-        .route_id = route_id,
-        .route_name = route_name,
-        .route_color = route_color,
-        .headsign = headsign,
-        .arrival_time = trip["arrivalTime"].as<time_t>(),
-        .departure_time = trip["departureTime"].as<time_t>(),
-        .is_realtime = trip["isRealtime"].as<bool>(),
-      });
     }
 
-    {
-      std::lock_guard<std::mutex> lock(this->schedule_state_.mutex);
-      this->schedule_state_.trips = std::move(new_trips);
+    // The server only pushes dictionaries when its version differs from ours
+    if (this->remote_dictionaries_) {
+      data["dictionaryVersion"] = this->remote_dictionaries_->version;
     }
-
-    return true;
   });
 
-  if (!valid) {
-    ESP_LOGW(TAG, "Failed to parse message (%u bytes); preview: %.120s",
-             static_cast<unsigned>(payload.size()), payload.c_str());
-    this->status_set_error(LOG_STR("Failed to parse schedule data"));
+  if (message == this->subscribe_message_) {
+    return;
   }
-}
-
-void TransitTracker::set_abbreviations_from_text(const std::string &text) {
-  this->abbreviations_.clear();
-  for (const auto &line : split(text, '\n')) {
-    auto parts = split(line, ';');
 
-    if (parts.size() == 1) {
-      // If only one part is provided, treat it as a removal (replace with empty string)
-      this->add_abbreviation(parts[0], "");
-      continue;
-    }
+  ESP_LOGD(TAG, "Subscribe payload updated (%u bytes)", static_cast<unsigned>(message.size()));
+  ESP_LOGV(TAG, "Subscribe payload: %s", message.c_str());
+  this->subscribe_message_ = std::move(message);
 
-    if (parts.size() != 2) {
-      ESP_LOGW(TAG, "Invalid abbreviation line: %s", line.c_str());
-      continue;
-    }
+  // Sent by the websocket task on every (re)connect, so loop() never waits on the socket
+  this->ws_client_.set_connect_message(this->subscribe_message_);
 
-    this->add_abbreviation(parts[0], parts[1]);
+  // styledRoutes or dictionaryVersion changed under an open connection
+  if (this->ws_client_.is_connected()) {
+    this->ws_client_.queue_text(this->subscribe_message_);
   }
 }
 
-void TransitTracker::set_route_styles_from_text(const std::string &text) {
-  this->route_styles_.clear();
-  for (const auto &line : split(text, '\n')) {
-    auto parts = split(line, ';');
-    if (parts.size() != 3) {
-      ESP_LOGW(TAG, "Invalid route style line: %s", line.c_str());
-      continue;
-    }
-    uint32_t color;
-    if (!parse_hex_color(parts[2], color)) {
-      ESP_LOGW(TAG, "Invalid route style color '%s' in line: %s", parts[2].c_str(), line.c_str());
-      continue;
-    }
-    this->add_route_style(parts[0], parts[1], Color(color));
-  }
-}
-
-void TransitTracker::draw_text_centered_(const char *text, Color color) {
-  int display_center_x = this->display_->get_width() / 2;
-  int display_center_y = this->display_->get_height() / 2;
-  this->display_->print(display_center_x, display_center_y, this->font_, color, display::TextAlign::CENTER, text);
-}
-
-void TransitTracker::set_realtime_color(const Color &color) {
-  this->realtime_color_ = color;
-  this->realtime_color_dark_ = Color(
-    (color.r * 0.5),
-    (color.g * 0.5),
-    (color.b * 0.5)
-  );
-}
-
-const uint8_t realtime_icon[6][6] = {
-  {0, 0, 0, 3, 3, 3},
-  {0, 0, 3, 0, 0, 0},
-  {0, 3, 0, 0, 2, 2},
-  {3, 0, 0, 2, 0, 0},
-  {3, 0, 2, 0, 0, 1},
-  {3, 0, 2, 0, 1, 1}
-};
-
-void HOT TransitTracker::draw_realtime_icon_(int bottom_right_x, int bottom_right_y, unsigned long uptime) {
-  const int num_frames = 6;
-  const int idle_frame_duration = 3000;
-  const int anim_frame_duration = 200;
-  const int cycle_duration = idle_frame_duration + (num_frames - 1) * anim_frame_duration;
-
-  unsigned long cycle_time = uptime % cycle_duration;
-
-  int frame;
-  if (cycle_time < idle_frame_duration) {
-    frame = 0;
-  } else {
-    frame = 1 + (cycle_time - idle_frame_duration) / anim_frame_duration;
+void TransitTracker::handle_dictionaries_(JsonObject data, const BulkString &payload) {
+  auto remote = std::make_unique<RemoteDictionaries>();
+  if (!parse_remote_dictionaries(data, *remote)) {
+    ESP_LOGW(TAG, "Ignoring dictionaries without a version (%u bytes)", static_cast<unsigned>(payload.size()));
+    return;
   }
 
-  auto is_segment_lit = [frame](uint8_t segment) {
-    switch (segment) {
-      case 1: return frame >= 1 && frame <= 3;
-      case 2: return frame >= 2 && frame <= 4;
-      case 3: return frame >= 3 && frame <= 5;
-      default: return false;
-    }
-  };
-
-  for (uint8_t i = 0; i < 6; ++i) {
-    for (uint8_t j = 0; j < 6; ++j) {
-      uint8_t segment_number = realtime_icon[i][j];
-      if (segment_number == 0) {
-        continue;
-      }
+  ESP_LOGD(TAG, "Received dictionaries version %s (%u bytes)", remote->version.c_str(),
+           static_cast<unsigned>(payload.size()));
 
-      Color icon_color = is_segment_lit(segment_number) ? this->realtime_color_ : this->realtime_color_dark_;
-      this->display_->draw_pixel_at(bottom_right_x - (5 - j), bottom_right_y - (5 - i), icon_color);
+  // Installed in loop(), off the websocket task; the flash write is deferred further
+  {
+    std::lock_guard<std::mutex> lock(this->dictionaries_mutex_);
+    this->pending_dictionaries_ = std::move(remote);
+    if (payload.size() <= DictionaryCache::MAX_PAYLOAD_SIZE) {
+      this->pending_dictionaries_payload_.assign(payload.data(), payload.size());
+    } else {
+      ESP_LOGW(TAG, "Dictionaries too large to cache (%u bytes)", static_cast<unsigned>(payload.size()));
+      this->pending_dictionaries_payload_.clear();
     }
   }
+  this->has_pending_dictionaries_ = true;
 }
 
-void TransitTracker::draw_trip(
-    const Trip &trip, int y_offset, int font_height, unsigned long uptime, uint rtc_now,
-    bool no_draw, int *headsign_overflow_out, int scroll_cycle_duration
-) {
-  if (!no_draw) {
-    this->display_->print(0, y_offset, this->font_, trip.route_color, display::TextAlign::TOP_LEFT, trip.route_name.c_str());
+void TransitTracker::load_cached_dictionaries_() {
+  std::string payload;
+  if (!this->dictionary_cache_.load(payload)) {
+    return;
   }
 
-  int route_width, _;
-  this->font_->measure(trip.route_name.c_str(), &route_width, &_, &_, &_);
-
-  auto time_display = this->localization_.fmt_duration_from_now(
-    this->display_departure_times_ ? trip.departure_time : trip.arrival_time,
-    rtc_now
-  );
+  JsonDocument doc(BulkJsonAllocator::instance());
+  auto remote = std::make_unique<RemoteDictionaries>();
+  if (deserializeJson(doc, payload) || !parse_remote_dictionaries(doc["data"], *remote)) {
+    ESP_LOGW(TAG, "Ignoring unreadable cached dictionaries");
+    return;
+  }
 
-  int time_width;
-  this->font_->measure(time_display.c_str(), &time_width, &_, &_, &_);
+  ESP_LOGD(TAG, "Loaded cached dictionaries version %s", remote->version.c_str());
+  this->remote_dictionaries_ = std::move(remote);
+  this->dictionaries_dirty_ = true;
+}
 
-  int headsign_clipping_start = route_width + 3;
-  int headsign_clipping_end = this->display_->get_width() - time_width - 2;
+void TransitTracker::install_pending_dictionaries_() {
+  std::unique_ptr<RemoteDictionaries> remote;
+  BulkString payload;
+  {
+    std::lock_guard<std::mutex> lock(this->dictionaries_mutex_);
+    remote = std::move(this->pending_dictionaries_);
+    payload = std::move(this->pending_dictionaries_payload_);
+  }
 
-  if (!no_draw) {
-    Color time_color = trip.is_realtime ? this->realtime_color_ : Color(0xa7a7a7);
-    this->display_->print(this->display_->get_width() + 1, y_offset, this->font_, time_color, display::TextAlign::TOP_RIGHT, time_display.c_str());
+  if (!remote) {
+    return;
   }
 
-  if (trip.is_realtime) {
-    headsign_clipping_end -= 8;
+  if (this->remote_dictionaries_ && this->remote_dictionaries_->version == remote->version) {
+    ESP_LOGD(TAG, "Dictionaries version %s already installed", remote->version.c_str());
+    return;
+  }
 
-    if(!no_draw) {
-      int icon_bottom_right_x = this->display_->get_width() - time_width - 2;
-      int icon_bottom_right_y = y_offset + font_height - 6;
+  ESP_LOGI(TAG, "Installing dictionaries version %s (%u abbreviations, %u route styles)",
+           remote->version.c_str(), static_cast<unsigned>(remote->abbreviations.size()),
+           static_cast<unsigned>(remote->route_styles.size()));
+  this->remote_dictionaries_ = std::move(remote);
+  this->dictionaries_dirty_ = true;
+  if (!payload.empty()) {
+    // Written by the cache's own task; a flash erase here would stall the display
+    this->dictionary_cache_.save_async(std::move(payload));
+  }
+}
 
-      this->draw_realtime_icon_(icon_bottom_right_x, icon_bottom_right_y, uptime);
-    }
+void TransitTracker::rebuild_dictionaries_() {
+  auto compiled = compile_dictionaries(this->remote_dictionaries_.get(), this->abbreviations_, this->route_styles_);
+  {
+    std::lock_guard<std::mutex> lock(this->dictionaries_mutex_);
+    this->dictionaries_ = std::move(compiled);
   }
+  this->dictionaries_dirty_ = false;
 
-  int headsign_max_width = headsign_clipping_end - headsign_clipping_start;
+  // The subscribe payload lists styled routes and the dictionary version
+  this->update_subscribe_message_();
+}
 
-  int headsign_actual_width;
-  this->font_->measure(trip.headsign.c_str(), &headsign_actual_width, &_, &_, &_);
+std::shared_ptr<const Dictionaries> TransitTracker::get_dictionaries_() {
+  std::lock_guard<std::mutex> lock(this->dictionaries_mutex_);
+  return this->dictionaries_;
+}
 
-  int headsign_overflow = headsign_actual_width - headsign_max_width;
-  if (headsign_overflow_out) {
-    *headsign_overflow_out = headsign_overflow;
+void TransitTracker::add_abbreviation(const std::string &from, const std::string &to) {
+  this->abbreviations_[from] = to;
+  if (this->abbreviation_import_) {
+    this->abbreviation_import_->added_abbreviations[from] = to;
   }
+  this->dictionaries_dirty_ = true;
+}
 
-  if (no_draw) {
-    return;
+void TransitTracker::add_route_style(const std::string &route_id, const std::string &name, const Color &color) {
+  this->route_styles_[route_id] = RouteStyle{name, color};
+  if (this->route_style_import_) {
+    this->route_style_import_->added_route_styles[route_id] = RouteStyle{name, color};
   }
+  this->dictionaries_dirty_ = true;
+}
 
-  int scroll_offset = 0;
-  if (headsign_overflow > 0 && scroll_cycle_duration > 0) {
-    /// Note: The scroll may jump if headsign_clipping_end changes (e.g. due to the width of the arrival time changing).
-    /// This is probably not a big deal, since the display makes sudden changes anyway (e.g. when routes are updated)
-    /// and this happens relatively infrequently.
-
-    int scroll_time = headsign_overflow * 1000 / scroll_speed;
-    int scroll_cycle_time = uptime % scroll_cycle_duration;
-
-    // Scroll idle (left side - default)
-    if(scroll_cycle_time < idle_time_left) {
-      // scroll_offset = 0; do nothing
-    } else if (scroll_cycle_time < idle_time_left + scroll_time) {
-      // Scrolling left
-      int time_since_scroll_start = scroll_cycle_time - idle_time_left;
-      scroll_offset = time_since_scroll_start * scroll_speed / 1000;
-    } else if (scroll_cycle_time < idle_time_left + scroll_time + idle_time_right) {
-      // Scroll idle (right side)
-      scroll_offset = headsign_overflow;
-    } else if (scroll_cycle_time < idle_time_left + 2 * scroll_time + idle_time_right){
-      // Scrolling right
-      int time_since_scroll_start = scroll_cycle_time - (idle_time_left + scroll_time + idle_time_right);
-      scroll_offset = headsign_overflow - (time_since_scroll_start * scroll_speed / 1000);
-    } else {
-      // Waiting for other headsigns to finish scrolling
-      // scroll_offset = 0; do nothing
-    }
-  }
+void TransitTracker::set_abbreviations_from_text(const std::string &text) {
+  // Replaces any import of the same kind that is still in progress
+  this->abbreviation_import_ = std::make_unique<TextImport>(text);
+}
 
-  this->display_->start_clipping(headsign_clipping_start, 0, headsign_clipping_end, this->display_->get_height());
-  this->display_->print(headsign_clipping_start - scroll_offset, y_offset, this->font_, trip.headsign.c_str());
-  this->display_->end_clipping();
+void TransitTracker::set_route_styles_from_text(const std::string &text) {
+  this->route_style_import_ = std::make_unique<TextImport>(text);
 }
 
-void HOT TransitTracker::draw_schedule() {
-  if (this->display_ == nullptr) {
-    ESP_LOGW(TAG, "No display attached, cannot draw schedule");
-    return;
-  }
+void TransitTracker::step_abbreviation_import_() {
+  TextImport &import = *this->abbreviation_import_;
 
-  if (!esphome::network::is_connected()) {
-    this->draw_text_centered_("Waiting for network", Color(0x252627));
-    return;
-  }
+  std::string_view line;
+  for (size_t i = 0; i < IMPORT_LINES_PER_LOOP; i++) {
+    if (!import.lines.next(line)) {
+      ESP_LOGD(TAG, "Imported %u abbreviations", static_cast<unsigned>(import.abbreviations.size()));
+      for (auto &entry : import.added_abbreviations) {
+        import.abbreviations[entry.first] = std::move(entry.second);
+      }
+      this->abbreviations_ = std::move(import.abbreviations);
+      this->dictionaries_dirty_ = true;
+      this->abbreviation_import_.reset();
+      return;
+    }
 
-  if (!this->rtc_->now().is_valid()) {
-    this->draw_text_centered_("Waiting for time sync", Color(0x252627));
-    return;
-  }
+    if (line.empty()) {
+      continue;
+    }
 
-  if (this->base_url_.empty()) {
-    this->draw_text_centered_("No base URL set", Color(0x252627));
-    return;
-  }
+    std::string_view parts[2];
+    size_t count = split_fields(line, ';', parts, 2);
 
-  if (this->status_has_error()) {
-    this->draw_text_centered_("Error loading schedule", Color(0xFE4C5C));
-    return;
-  }
+    if (parts[0].empty()) {
+      // an empty pattern would match at the start of every headsign
+      ESP_LOGW(TAG, "Ignoring abbreviation with empty text: %.*s", static_cast<int>(line.size()), line.data());
+      continue;
+    }
 
-  if (!this->has_ever_connected_.load()) {
-    this->draw_text_centered_("Loading...", Color(0x252627));
-    return;
-  }
+    if (count == 1) {
+      // If only one part is provided, treat it as a removal (replace with empty string)
+      import.abbreviations[std::string(parts[0])] = "";
+      continue;
+    }
 
-  std::lock_guard<std::mutex> lock(this->schedule_state_.mutex);
+    if (count != 2) {
+      ESP_LOGW(TAG, "Invalid abbreviation line: %.*s", static_cast<int>(line.size()), line.data());
+      continue;
+    }
 
-  if (this->schedule_state_.trips.empty()) {
-    auto message = this->display_departure_times_ ? "No upcoming departures" : "No upcoming arrivals";
-    this->draw_text_centered_(message, Color(0x252627));
-    return;
+    import.abbreviations[std::string(parts[0])] = std::string(parts[1]);
   }
+}
 
-  int nominal_font_height = this->font_->get_ascender() + this->font_->get_descender();
-  unsigned long uptime = millis();
-  uint rtc_now = this->rtc_->now().timestamp;
+void TransitTracker::step_route_style_import_() {
+  TextImport &import = *this->route_style_import_;
 
-  int scroll_cycle_duration = 0;
-  if (this->scroll_headsigns_) {
-    int largest_headsign_overflow = 0;
-    for (const Trip &trip : this->schedule_state_.trips) {
-      int headsign_overflow;
-      this->draw_trip(trip, 0, nominal_font_height, uptime, rtc_now, true, &headsign_overflow);
-      largest_headsign_overflow = std::max(largest_headsign_overflow, headsign_overflow);
+  std::string_view line;
+  for (size_t i = 0; i < IMPORT_LINES_PER_LOOP; i++) {
+    if (!import.lines.next(line)) {
+      ESP_LOGD(TAG, "Imported %u route styles", static_cast<unsigned>(import.route_styles.size()));
+      for (auto &entry : import.added_route_styles) {
+        import.route_styles[entry.first] = std::move(entry.second);
+      }
+      this->route_styles_ = std::move(import.route_styles);
+      this->dictionaries_dirty_ = true;
+      this->route_style_import_.reset();
+      return;
     }
 
-    if (largest_headsign_overflow > 0) {
-      int longest_scroll_time = largest_headsign_overflow * 1000 / scroll_speed;
-      scroll_cycle_duration = idle_time_left + idle_time_right + 2*longest_scroll_time;
+    if (line.empty()) {
+      continue;
     }
-  }
 
-  int max_trips_height = (this->limit_ * this->font_->get_ascender()) + ((this->limit_ - 1) * this->font_->get_descender());
-  int y_offset = (this->display_->get_height() % max_trips_height) / 2;
+    std::string_view parts[3];
+    if (split_fields(line, ';', parts, 3) != 3) {
+      ESP_LOGW(TAG, "Invalid route style line: %.*s", static_cast<int>(line.size()), line.data());
+      continue;
+    }
 
-  bool has_header_text = !this->header_text_.empty();
-  if (has_header_text) {
-    this->display_->print(0, y_offset, this->font_, Color(0x00bdbd), display::TextAlign::LEFT, this->header_text_.c_str());
-    y_offset += nominal_font_height;
-  }
+    uint32_t color;
+    if (!parse_hex_color(parts[2], color)) {
+      ESP_LOGW(TAG, "Invalid route style color '%.*s' in line: %.*s", static_cast<int>(parts[2].size()),
+               parts[2].data(), static_cast<int>(line.size()), line.data());
+      continue;
+    }
 
-  for (const Trip &trip : this->schedule_state_.trips) {
-    this->draw_trip(trip, y_offset, nominal_font_height, uptime, rtc_now, false, nullptr, scroll_cycle_duration);
-    y_offset += nominal_font_height;
+    import.route_styles[std::string(parts[0])] = RouteStyle{std::string(parts[1]), Color(color)};
   }
 }
 
+void HOT TransitTracker::draw_schedule() {
+  // Scrolling and the realtime icon hold still in low-activity mode
+  this->draw_schedule_at(this->idle_ ? 0 : millis(), this->rtc_->timestamp_now(), this->get_render_status());
+}
+
+void HOT TransitTracker::draw_schedule_at(unsigned long uptime, uint rtc_now, uint32_t status) {
+  this->renderer_.draw(uptime, rtc_now, status);
+}
+
 }  // namespace transit_tracker
 }  // namespace esphome
@@ -2,24 +2,46 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
+#include "esphome/core/automation.h"
 #include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
 #include "esphome/components/display/display.h"
 #include "esphome/components/font/font.h"
+#include "esphome/components/json/json_util.h"
 #include "esphome/components/time/real_time_clock.h"
 
+#include "dictionaries.h"
+#include "reconnect_policy.h"
+#include "schedule_feed.h"
+#include "schedule_renderer.h"
 #include "schedule_state.h"
 #include "localization.h"
+#include "memory.h"
+#include "string_utils.h"
 #include "websocket_client.h"
 
 namespace esphome {
 namespace transit_tracker {
 
-struct RouteStyle {
-  std::string name;
-  Color color;
+/// A text blob being imported a few lines per loop() iteration
+struct TextImport {
+  explicit TextImport(const std::string &text) : text(text), lines(this->text, '\n') {}
+  TextImport(const TextImport &) = delete;
+  TextImport &operator=(const TextImport &) = delete;
+
+  std::string text;
+  Tokenizer lines;  // views into text
+  AbbreviationMap abbreviations;
+  RouteStyleMap route_styles;
+
+  // Entries added while the import runs; applied on top of it when it finishes
+  AbbreviationMap added_abbreviations;
+  RouteStyleMap added_route_styles;
 };
 
 class TransitTracker : public Component {
@@ -36,82 +58,175 @@ class TransitTracker : public Component {
     void close(bool fully = false);
 
     void draw_schedule();
+    /// Draws the schedule as it would appear at the given animation clock (ms, drives scrolling
+    /// and the realtime icon), wall-clock time (drives countdowns) and connection status
+    /// (RENDER_STATE_* flags). For a given schedule, the same arguments draw the same frame.
+    void draw_schedule_at(unsigned long uptime, uint rtc_now, uint32_t status);
+    /// The live RENDER_STATE_* flags that draw_schedule() renders with.
+    uint32_t get_render_status() const { return this->render_state_.load() & RENDER_STATE_FLAGS_MASK; }
+
+#ifdef USE_TRANSIT_TRACKER_PROFILER
+    /// Logs per-stage draw timings collected since boot.
+    void dump_frame_profile() const { this->renderer_.dump_frame_profile(); }
+#endif
 
     Localization* get_localization() { return &this->localization_; }
 
-    void set_display(display::Display *display) { display_ = display; }
-    void set_font(font::Font *font) { font_ = font; }
+    void set_display(display::Display *display) {
+      display_ = display;
+      renderer_.set_display(display);
+    }
+    void set_font(font::Font *font) { renderer_.set_font(font); }
     void set_rtc(time::RealTimeClock *rtc) { rtc_ = rtc; }
 
-    void set_base_url(const std::string &base_url) { base_url_ = base_url; }
+    void set_base_url(const std::string &base_url) {
+      base_url_ = base_url;
+      renderer_.set_has_base_url(!base_url.empty());
+    }
     void set_feed_code(const std::string &feed_code) { feed_code_ = feed_code; }
-    void set_display_departure_times(bool display_departure_times) { display_departure_times_ = display_departure_times; }
+    void set_display_departure_times(bool display_departure_times) {
+      display_departure_times_ = display_departure_times;
+      schedule_state_.set_sort_by_departure(display_departure_times);
+      feed_.set_display_departure_times(display_departure_times);
+      renderer_.set_display_departure_times(display_departure_times);
+    }
     void set_schedule_string(const std::string &schedule_string) { schedule_string_ = schedule_string; }
+    /// When set, the schedule string is in the grouped `stop,offset:route,route;...` form and
+    /// is sent as `stopRoutes` instead of `routeStopPairs`.
+    void set_grouped_schedule(bool grouped_schedule) { grouped_schedule_ = grouped_schedule; }
     void set_list_mode(const std::string &list_mode) { list_mode_ = list_mode; }
-    void set_limit(int limit) { limit_ = limit; }
-    void set_scroll_headsigns(bool scroll_headsigns) { scroll_headsigns_ = scroll_headsigns; }
-
-    void set_header_text(const std::string &header_text) { header_text_ = header_text; }
+    void set_limit(int limit) {
+      limit_ = limit;
+      feed_.set_limit(limit);
+      renderer_.set_limit(limit);
+    }
+    void set_scroll_headsigns(bool scroll_headsigns) { renderer_.set_scroll_headsigns(scroll_headsigns); }
+    void set_memory_placement(MemoryPlacement placement) { set_bulk_memory_placement(placement); }
+    void set_compression(bool compression) { this->ws_client_.set_compression(compression); }
+    void set_compression_window_bits(int bits) { this->ws_client_.set_compression_window_bits(bits); }
+    void set_reconnect_delay(uint32_t ms) { this->ws_client_.set_reconnect_timeout_ms(ms); }
+    void set_max_reconnect_delay(uint32_t ms) { this->ws_client_.set_max_reconnect_timeout_ms(ms); }
+
+    void set_header_text(const std::string &header_text) { renderer_.set_header_text(header_text); }
     void set_unit_display(UnitDisplay unit_display) { this->localization_.set_unit_display(unit_display); }
-    void add_abbreviation(const std::string &from, const std::string &to) { abbreviations_[from] = to; }
+    void add_abbreviation(const std::string &from, const std::string &to);
     void add_header(const std::string &name, const std::string &value) { extra_headers_.emplace_back(name, value); }
-    void set_default_route_color(const Color &color) { default_route_color_ = color; }
-    void add_route_style(const std::string &route_id, const std::string &name, const Color &color) { route_styles_[route_id] = RouteStyle{name, color}; }
+    void set_default_route_color(const Color &color) { feed_.set_default_route_color(color); }
+    void add_route_style(const std::string &route_id, const std::string &name, const Color &color);
 
     void set_abbreviations_from_text(const std::string &text);
     void set_route_styles_from_text(const std::string &text);
 
-    void set_realtime_color(const Color &color);
+    void set_realtime_color(const Color &color) { renderer_.set_realtime_color(color); }
 
-  protected:
-    static constexpr int scroll_speed = 10; // pixels/second
-    static constexpr int idle_time_left = 5000;
-    static constexpr int idle_time_right = 1000;
+    void set_idle_enabled(bool idle_enabled) { idle_enabled_ = idle_enabled; }
+    void set_idle_threshold(uint32_t seconds) { idle_threshold_s_ = seconds; }
+    void set_idle_update_interval(uint32_t ms) { idle_update_interval_ms_ = ms; }
+    void set_idle_ping_interval(int seconds) { idle_ping_interval_s_ = seconds; }
+    void set_quiet_hours(int start_hour, int end_hour) { quiet_hours_start_ = start_hour; quiet_hours_end_ = end_hour; }
+
+    /// True while nothing is coming up soon (or during quiet hours) and the display refreshes slowly
+    bool is_idle() const { return idle_; }
+    void add_on_idle_change_callback(std::function<void(bool)> &&callback) { idle_callback_.add(std::move(callback)); }
 
+  protected:
     std::string from_now_(time_t unix_timestamp, uint rtc_now) const;
-    void draw_text_centered_(const char *text, Color color);
-    void draw_realtime_icon_(int bottom_right_x, int bottom_right_y, unsigned long now);
 
-    void draw_trip(
-      const Trip &trip, int y_offset, int font_height, unsigned long uptime, uint rtc_now,
-      bool no_draw = false, int *headsign_overflow_out = nullptr, int scroll_cycle_duration = 0
-    );
+    time_t display_time_(const Trip &trip) const { return this->schedule_state_.sort_time(trip); }
 
     Localization localization_{};
     ScheduleState schedule_state_;
+    ScheduleFeed feed_{schedule_state_};
+    ScheduleRenderer renderer_{schedule_state_, localization_};
 
     display::Display *display_;
-    font::Font *font_;
     time::RealTimeClock *rtc_;
 
     WebSocketClient ws_client_;
-
-    void handle_message_(const std::string &payload);
-    void send_subscribe_();
+    ConnectionMonitor connection_monitor_;
+
+    void handle_dictionaries_(JsonObject data, const BulkString &payload);
+    void load_cached_dictionaries_();
+    void install_pending_dictionaries_();
+    void rebuild_dictionaries_();
+    void step_abbreviation_import_();
+    void step_route_style_import_();
+    std::shared_ptr<const Dictionaries> get_dictionaries_();
+    void update_subscribe_message_();
     void on_disconnect_();
+    void check_connection_recovery_();
+    void update_render_state_();
+    void publish_schedule_generation_(uint32_t generation);
+    void update_idle_state_();
+    void set_idle_(bool idle);
 
-    std::atomic<int> consecutive_disconnects_{0};
     std::atomic<unsigned long> last_heartbeat_{0};
-    std::atomic<bool> has_ever_connected_{false};
-    std::atomic<bool> pending_subscribe_{false};
+    std::atomic<uint32_t> render_state_{0};
+    std::atomic<bool> pending_clear_error_{false};
     std::atomic<bool> fully_closed_{false};
 
     std::string base_url_;
     std::vector<std::pair<std::string, std::string>> extra_headers_;
     std::string feed_code_;
     std::string schedule_string_;
+    bool grouped_schedule_ = false;
     std::string list_mode_;
+    std::string subscribe_message_;
     bool display_departure_times_ = true;
     int limit_;
 
-    std::string header_text_;
-    std::map<std::string, std::string> abbreviations_;
-    Color default_route_color_ = Color(0x028e51);
-    std::map<std::string, RouteStyle> route_styles_;
-    bool scroll_headsigns_ = false;
+    AbbreviationMap abbreviations_;
+    RouteStyleMap route_styles_;
+    std::unique_ptr<TextImport> abbreviation_import_;
+    std::unique_ptr<TextImport> route_style_import_;
+
+    // Server-pushed dictionaries; only touched from the main loop
+    std::unique_ptr<RemoteDictionaries> remote_dictionaries_;
+    DictionaryCache dictionary_cache_;
+    bool dictionaries_dirty_ = true;
+
+    // Guards the compiled dictionaries the parser reads and the hand-off
+    // of newly received ones from the websocket task to loop()
+    std::mutex dictionaries_mutex_;
+    std::shared_ptr<const Dictionaries> dictionaries_;
+    std::unique_ptr<RemoteDictionaries> pending_dictionaries_;
+    BulkString pending_dictionaries_payload_;  // empty when too large to cache
+    std::atomic<bool> has_pending_dictionaries_{false};
+
+    bool idle_enabled_ = false;
+    bool idle_ = false;
+    uint32_t idle_threshold_s_ = 3600;
+    uint32_t idle_update_interval_ms_ = 60000;
+    int idle_ping_interval_s_ = 0;  // 0 keeps the normal ping interval
+    int quiet_hours_start_ = -1;
+    int quiet_hours_end_ = -1;
+    uint32_t active_update_interval_ms_ = 0;
+    int active_ping_interval_s_ = 0;
+    uint32_t idle_render_state_ = 0;  // render_state_ seen by the previous loop()
+    unsigned long last_idle_check_ = 0;
+    CallbackManager<void(bool)> idle_callback_;
+};
+
+class IdleTrigger : public Trigger<> {
+  public:
+    explicit IdleTrigger(TransitTracker *parent) {
+      parent->add_on_idle_change_callback([this](bool idle) {
+        if (idle) {
+          this->trigger();
+        }
+      });
+    }
+};
 
-    Color realtime_color_ = Color(0x20FF00);
-    Color realtime_color_dark_ = Color(0x00A700);
+class ActiveTrigger : public Trigger<> {
+  public:
+    explicit ActiveTrigger(TransitTracker *parent) {
+      parent->add_on_idle_change_callback([this](bool idle) {
+        if (!idle) {
+          this->trigger();
+        }
+      });
+    }
 };
 
 
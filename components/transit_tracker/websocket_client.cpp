@@ -2,6 +2,7 @@
 
 #include <cstring>
 
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 #include "sdkconfig.h"
 
@@ -14,6 +15,14 @@ namespace transit_tracker {
 
 static const char *const TAG = "transit_tracker.ws";
 
+static constexpr size_t MAX_QUEUED_MESSAGES = 4;
+static constexpr int SEND_TIMEOUT_MS = 5000;
+// Pause before retrying a send that failed on a connection that is still up
+static constexpr int SEND_RETRY_DELAY_MS = 500;
+static constexpr uint32_t SENDER_TASK_STACK_SIZE = 3072;
+// Same as the websocket task, so a queued subscribe isn't starved by message parsing
+static constexpr UBaseType_t SENDER_TASK_PRIORITY = 5;
+
 static const char *error_type_to_string(esp_websocket_error_type_t t) {
   switch (t) {
     case WEBSOCKET_ERROR_TYPE_NONE: return "none";
@@ -50,6 +59,11 @@ static void log_error_details(const esp_websocket_event_data_t *data) {
 }
 
 WebSocketClient::~WebSocketClient() {
+  std::lock_guard<std::mutex> lock(client_mutex_);
+  if (sender_task_handle_ != nullptr) {
+    vTaskDelete(sender_task_handle_);
+    sender_task_handle_ = nullptr;
+  }
   if (client_ != nullptr) {
     esp_websocket_client_destroy(client_);
     client_ = nullptr;
@@ -62,12 +76,46 @@ bool WebSocketClient::start() {
     return false;
   }
 
+  if (sender_task_handle_ == nullptr &&
+      xTaskCreate(WebSocketClient::sender_task_, "tt_ws_send", SENDER_TASK_STACK_SIZE, this, SENDER_TASK_PRIORITY,
+                  &sender_task_handle_) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start the sender task");
+    sender_task_handle_ = nullptr;
+    return false;
+  }
+
+  if (compression_ && inflater_ == nullptr) {
+    // The size limit also bounds how far a compression bomb can expand
+    inflater_ = std::make_unique<TinflInflater>();
+    if (inflater_->init(compression_window_bits_)) {
+      assembler_.set_inflater(inflater_.get());
+    } else {
+      ESP_LOGW(TAG, "Not enough memory for a %u byte inflate window; disabling compression",
+               1u << compression_window_bits_);
+      inflater_.reset();
+      compression_ = false;
+    }
+  }
+
   if (client_ == nullptr) {
+    if (compression_) {
+      // We never compress outgoing messages, and ask the server to reset its
+      // context per message so a single bounded window is enough to inflate
+      connect_headers_ = headers_ + str_sprintf(
+          "Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover; "
+          "server_no_context_takeover; server_max_window_bits=%d\r\n",
+          compression_window_bits_);
+    } else {
+      connect_headers_ = headers_;
+    }
+
     esp_websocket_client_config_t cfg = {};
     cfg.uri = uri_.c_str();
     cfg.user_agent = user_agent_.empty() ? nullptr : user_agent_.c_str();
-    cfg.headers = headers_.empty() ? nullptr : headers_.c_str();
-    cfg.reconnect_timeout_ms = reconnect_timeout_ms_;
+    cfg.headers = connect_headers_.empty() ? nullptr : connect_headers_.c_str();
+    // What the first retry waits; see schedule_reconnect_()
+    reconnect_delay_ms_ = backoff_.on_connected(random_uint32());
+    cfg.reconnect_timeout_ms = reconnect_delay_ms_;
     cfg.network_timeout_ms = network_timeout_ms_;
     cfg.buffer_size = buffer_size_;
     cfg.enable_close_reconnect = true;
@@ -77,10 +125,12 @@ bool WebSocketClient::start() {
     cfg.keep_alive_idle = 5;
     cfg.keep_alive_interval = 5;
     cfg.keep_alive_count = 3;
+    cfg.ping_interval_sec = ping_interval_sec_;
 #if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
     cfg.crt_bundle_attach = esp_crt_bundle_attach;
 #endif
 
+    std::lock_guard<std::mutex> lock(client_mutex_);
     client_ = esp_websocket_client_init(&cfg);
     if (client_ == nullptr) {
       ESP_LOGE(TAG, "Failed to initialize websocket client");
@@ -100,24 +150,117 @@ bool WebSocketClient::start() {
 }
 
 void WebSocketClient::stop() {
-  if (client_ == nullptr) {
-    return;
+  {
+    // Waits for a send in progress on the sender task to finish or time out
+    std::lock_guard<std::mutex> lock(client_mutex_);
+    if (client_ == nullptr) {
+      return;
+    }
+
+    // don't call from inside an event handler; destroy waits for the WS task
+    esp_websocket_client_stop(client_);
+    esp_websocket_client_destroy(client_);
+    client_ = nullptr;
   }
+  assembler_.reset();
 
-  // don't call from inside an event handler; destroy waits for the WS task
-  esp_websocket_client_stop(client_);
-  esp_websocket_client_destroy(client_);
-  client_ = nullptr;
-  message_buffer_.clear();
+  // the connect message covers anything still queued for the next connection
+  std::lock_guard<std::mutex> lock(send_mutex_);
+  send_queue_.clear();
+  send_queue_epoch_++;
 }
 
-bool WebSocketClient::send_text(const std::string &data) {
-  if (!is_connected()) {
-    return false;
+void WebSocketClient::set_ping_interval_sec(int sec) {
+  ping_interval_sec_ = sec;
+  if (client_ != nullptr) {
+    esp_websocket_client_set_ping_interval_sec(client_, sec);
+  }
+}
+
+void WebSocketClient::set_connect_message(const std::string &message) {
+  std::lock_guard<std::mutex> lock(send_mutex_);
+  connect_message_ = message;
+}
+
+void WebSocketClient::queue_text(const std::string &message) {
+  std::lock_guard<std::mutex> lock(send_mutex_);
+  if (send_queue_.size() >= MAX_QUEUED_MESSAGES) {
+    ESP_LOGW(TAG, "Send queue full; dropping oldest message");
+    send_queue_.pop_front();
+  }
+  send_queue_.push_back(message);
+  if (sender_task_handle_ != nullptr) {
+    xTaskNotifyGive(sender_task_handle_);
+  }
+}
+
+void WebSocketClient::sender_task_(void *arg) {
+  auto *self = static_cast<WebSocketClient *>(arg);
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->send_queued_();
+  }
+}
+
+void WebSocketClient::send_queued_() {
+  // Runs on the sender task, so waiting on the client lock (held while a message
+  // streams in) or a full socket never holds up the main loop
+  while (true) {
+    std::string message;
+    uint32_t epoch;
+    {
+      std::lock_guard<std::mutex> lock(send_mutex_);
+      if (send_queue_.empty()) {
+        return;
+      }
+      message = std::move(send_queue_.front());
+      send_queue_.pop_front();
+      epoch = send_queue_epoch_;
+    }
+
+    bool connected;
+    {
+      std::lock_guard<std::mutex> lock(client_mutex_);
+      connected = is_connected();
+      if (connected && esp_websocket_client_send_text(client_, message.data(), message.size(),
+                                                      pdMS_TO_TICKS(SEND_TIMEOUT_MS)) >= 0) {
+        continue;
+      }
+    }
+
+    if (!connected) {
+      // The connect message re-subscribes once the connection is back
+      return;
+    }
+
+    ESP_LOGW(TAG, "Send failed (%u bytes); retrying", static_cast<unsigned>(message.size()));
+    {
+      std::lock_guard<std::mutex> lock(send_mutex_);
+      if (send_queue_epoch_ != epoch) {
+        return;  // disconnected meanwhile; the connect message supersedes it
+      }
+      send_queue_.push_front(std::move(message));
+    }
+    vTaskDelay(pdMS_TO_TICKS(SEND_RETRY_DELAY_MS));
+  }
+}
+
+void WebSocketClient::send_connect_message_() {
+  std::string connect_message;
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    connect_message = connect_message_;
+  }
+  if (connect_message.empty()) {
+    return;
   }
 
-  int sent = esp_websocket_client_send_text(client_, data.c_str(), data.size(), pdMS_TO_TICKS(5000));
-  return sent >= 0;
+  // Runs on the websocket task, so a slow send only delays reading, never the main loop
+  ESP_LOGD(TAG, "Sending connect message (%u bytes)", static_cast<unsigned>(connect_message.size()));
+  if (esp_websocket_client_send_text(client_, connect_message.data(), connect_message.size(),
+                                     pdMS_TO_TICKS(SEND_TIMEOUT_MS)) < 0) {
+    ESP_LOGW(TAG, "Connect message send failed");
+  }
 }
 
 bool WebSocketClient::is_connected() const {
@@ -131,6 +274,8 @@ void WebSocketClient::event_handler_(void *handler_args, esp_event_base_t base,
   switch (event_id) {
     case WEBSOCKET_EVENT_CONNECTED:
       ESP_LOGI(TAG, "Connected to %s", self->uri_.c_str());
+      self->reset_reconnect_delay_();
+      self->send_connect_message_();
       if (self->on_connected_) {
         self->on_connected_();
       }
@@ -139,14 +284,28 @@ void WebSocketClient::event_handler_(void *handler_args, esp_event_base_t base,
     case WEBSOCKET_EVENT_DISCONNECTED:
       ESP_LOGW(TAG, "Disconnected");
       log_error_details(data);
-      self->message_buffer_.clear();
+      self->assembler_.reset();
+      {
+        // The connect message re-subscribes with the latest payload on reconnect
+        std::lock_guard<std::mutex> lock(self->send_mutex_);
+        self->send_queue_.clear();
+        self->send_queue_epoch_++;
+      }
+      self->schedule_reconnect_();
       if (self->on_disconnected_) {
         self->on_disconnected_();
       }
       break;
 
     case WEBSOCKET_EVENT_DATA:
-      self->handle_data_(data);
+      self->assembler_.feed(FrameChunk{
+          .op_code = data->op_code,
+          .fin = data->fin,
+          .payload_len = data->payload_len,
+          .payload_offset = data->payload_offset,
+          .data = data->data_ptr,
+          .data_len = data->data_len,
+      });
       break;
 
     case WEBSOCKET_EVENT_ERROR:
@@ -160,7 +319,7 @@ void WebSocketClient::event_handler_(void *handler_args, esp_event_base_t base,
 
     case WEBSOCKET_EVENT_CLOSED:
       ESP_LOGI(TAG, "Closed");
-      self->message_buffer_.clear();
+      self->assembler_.reset();
       break;
 
     case WEBSOCKET_EVENT_BEFORE_CONNECT:
@@ -172,38 +331,66 @@ void WebSocketClient::event_handler_(void *handler_args, esp_event_base_t base,
   }
 }
 
-void WebSocketClient::handle_data_(const esp_websocket_event_data_t *data) {
-  const uint8_t op = data->op_code;
+void WebSocketClient::reset_reconnect_delay_() {
+  // Otherwise the next outage would start from wherever the last one left off
+  reconnect_delay_ms_ = backoff_.on_connected(random_uint32());
+  esp_websocket_client_set_reconnect_timeout(client_, reconnect_delay_ms_);
+}
 
-  // Log close frames (op 0x08) for diagnostics before the connection tears down
-  if (op == 0x08 && data->data_len >= 2) {
-    auto bytes = reinterpret_cast<const uint8_t *>(data->data_ptr);
-    uint16_t close_code = (static_cast<uint16_t>(bytes[0]) << 8) | bytes[1];
-    if (data->data_len > 2) {
-      ESP_LOGW(TAG, "Server sent close: code=%u reason=\"%.*s\"", close_code,
-               data->data_len - 2, data->data_ptr + 2);
-    } else {
-      ESP_LOGW(TAG, "Server sent close: code=%u", close_code);
-    }
-    return;
-  }
+void WebSocketClient::schedule_reconnect_() {
+  // When a server restart drops every sign at once, retries spread out instead
+  // of arriving as one synchronized storm. The client already latched the delay
+  // configured last time, so this one is for the attempt after.
+  ESP_LOGD(TAG, "Reconnecting in %u ms (attempt %d)", static_cast<unsigned>(reconnect_delay_ms_),
+           backoff_.get_attempts());
+  reconnect_delay_ms_ = backoff_.on_disconnected(random_uint32());
+  esp_websocket_client_set_reconnect_timeout(client_, reconnect_delay_ms_);
+}
 
-  const bool is_data_frame = (op == 0x00 || op == 0x01 || op == 0x02);
-  if (!is_data_frame || data->payload_len <= 0) {
-    return;
-  }
+TinflInflater::~TinflInflater() {
+  bulk_free(decompressor_);
+  bulk_free(window_);
+}
 
-  if (data->payload_offset == 0) {
-    message_buffer_.clear();
-    message_buffer_.reserve(data->payload_len);
-  }
+bool TinflInflater::init(int window_bits) {
+  window_size_ = 1u << window_bits;
+  decompressor_ = static_cast<tinfl_decompressor *>(bulk_malloc(sizeof(tinfl_decompressor)));
+  window_ = static_cast<uint8_t *>(bulk_malloc(window_size_));
+  return decompressor_ != nullptr && window_ != nullptr;
+}
+
+void TinflInflater::reset() {
+  tinfl_init(decompressor_);
+  window_pos_ = 0;
+}
 
-  message_buffer_.append(data->data_ptr, data->data_len);
+bool TinflInflater::inflate(const uint8_t *data, size_t len, MessageAssembler &out) {
+  while (true) {
+    size_t in_size = len;
+    size_t out_size = window_size_ - window_pos_;
+    tinfl_status status = tinfl_decompress(decompressor_, data, &in_size, window_, window_ + window_pos_, &out_size,
+                                           TINFL_FLAG_HAS_MORE_INPUT);
 
-  const bool message_complete = (data->payload_offset + data->data_len) >= data->payload_len;
-  if (message_complete && data->fin && on_message_) {
-    on_message_(message_buffer_);
-    message_buffer_.clear();
+    if (!out.append(reinterpret_cast<const char *>(window_ + window_pos_), out_size)) {
+      return false;
+    }
+    window_pos_ = (window_pos_ + out_size) & (window_size_ - 1);
+    data += in_size;
+    len -= in_size;
+
+    if (status < TINFL_STATUS_DONE) {
+      ESP_LOGW(TAG, "Inflate error (status=%d)", status);
+      return false;
+    }
+
+    if (status != TINFL_STATUS_HAS_MORE_OUTPUT && len == 0) {
+      return true;
+    }
+
+    if (in_size == 0 && out_size == 0) {
+      // no progress; the stream ended before the input did
+      return status == TINFL_STATUS_DONE;
+    }
   }
 }
 
@@ -1,17 +1,49 @@
 #pragma once
 
-#include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "esp_websocket_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "rom/miniz.h"
+
+#include "memory.h"
+#include "message_assembler.h"
+#include "reconnect_policy.h"
 
 namespace esphome {
 namespace transit_tracker {
 
+/// Inflates through the ROM miniz decoder with a wrapping window of 2^window_bits
+/// bytes, the most the server may reference under server_max_window_bits.
+class TinflInflater : public Inflater {
+ public:
+  TinflInflater() = default;
+  ~TinflInflater() override;
+
+  TinflInflater(const TinflInflater &) = delete;
+  TinflInflater &operator=(const TinflInflater &) = delete;
+
+  /// Allocates the decoder and window. Returns false if there isn't enough memory.
+  bool init(int window_bits);
+
+  void reset() override;
+  bool inflate(const uint8_t *data, size_t len, MessageAssembler &out) override;
+
+ protected:
+  tinfl_decompressor *decompressor_{nullptr};
+  uint8_t *window_{nullptr};
+  size_t window_size_{0};
+  size_t window_pos_{0};
+};
+
 class WebSocketClient {
  public:
-  using MessageCallback = std::function<void(const std::string &)>;
+  using MessageCallback = MessageAssembler::MessageCallback;
   using StateCallback = std::function<void()>;
 
   WebSocketClient() = default;
@@ -23,36 +55,79 @@ class WebSocketClient {
   void set_uri(const std::string &uri) { uri_ = uri; }
   void set_user_agent(const std::string &user_agent) { user_agent_ = user_agent; }
   void set_headers(const std::string &headers) { headers_ = headers; }
-  void set_reconnect_timeout_ms(int ms) { reconnect_timeout_ms_ = ms; }
+  /// Delay before the first reconnect attempt; later attempts back off exponentially.
+  void set_reconnect_timeout_ms(int ms) { backoff_.set_base_delay_ms(ms); }
+  void set_max_reconnect_timeout_ms(int ms) { backoff_.set_max_delay_ms(ms); }
   void set_network_timeout_ms(int ms) { network_timeout_ms_ = ms; }
   void set_buffer_size(int bytes) { buffer_size_ = bytes; }
+  void set_ping_interval_sec(int sec);
+  int get_ping_interval_sec() const { return ping_interval_sec_; }
+  void set_compression(bool enabled) { compression_ = enabled; }
+  void set_compression_window_bits(int bits) { compression_window_bits_ = bits; }
 
-  void set_on_message(MessageCallback cb) { on_message_ = std::move(cb); }
+  void set_on_message(MessageCallback cb) { assembler_.set_on_message(std::move(cb)); }
+  /// Called with everything received so far after each fragment of a message that isn't complete yet.
+  void set_on_partial_message(MessageCallback cb) { assembler_.set_on_partial_message(std::move(cb)); }
+  /// Called when the first fragment of a new message arrives, including ones that are later dropped.
+  void set_on_message_start(StateCallback cb) { assembler_.set_on_message_start(std::move(cb)); }
   void set_on_connected(StateCallback cb) { on_connected_ = std::move(cb); }
   void set_on_disconnected(StateCallback cb) { on_disconnected_ = std::move(cb); }
 
   bool start();
   void stop();
-  bool send_text(const std::string &data);
+
+  /// Sent from the websocket task as soon as each connection is established.
+  void set_connect_message(const std::string &message);
+  /// Queues a text message for the current connection; the sender task sends it.
+  /// Dropped if the connection closes first, since the connect message supersedes it.
+  void queue_text(const std::string &message);
   bool is_connected() const;
+  bool is_compression_enabled() const { return compression_; }
+  /// True while a fragmented message is partway through being received
+  bool is_receiving() const { return assembler_.is_receiving(); }
+
+  /// Total bytes of message payload received on the wire (compressed or not)
+  uint32_t get_wire_bytes() const { return assembler_.get_wire_bytes(); }
+  /// Total bytes of message payload after decompression
+  uint32_t get_message_bytes() const { return assembler_.get_message_bytes(); }
 
  protected:
   static void event_handler_(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
-  void handle_data_(const esp_websocket_event_data_t *data);
+  static void sender_task_(void *arg);
+  void send_queued_();
+  void send_connect_message_();
+  void reset_reconnect_delay_();
+  void schedule_reconnect_();
 
   esp_websocket_client_handle_t client_{nullptr};
   std::string uri_;
   std::string user_agent_;
   std::string headers_;
-  int reconnect_timeout_ms_{5000};
+  std::string connect_headers_;
+  // only touched on the websocket task and in start()
+  ReconnectBackoff backoff_;
+  uint32_t reconnect_delay_ms_{0};  // configured on the client; the next drop waits this long
   int network_timeout_ms_{10000};
   int buffer_size_{4096};
+  int ping_interval_sec_{10};
+  bool compression_{false};
+  int compression_window_bits_{11};
+
+  // Held while the sender task uses client_, so stop() can't destroy it mid-send.
+  // Never taken on the websocket task: stop() holds it while waiting for that task.
+  std::mutex client_mutex_;
+  TaskHandle_t sender_task_handle_{nullptr};
+
+  std::mutex send_mutex_;
+  std::string connect_message_;
+  std::deque<std::string> send_queue_;
+  uint32_t send_queue_epoch_{0};  // bumped whenever the queue is cleared
 
-  MessageCallback on_message_;
   StateCallback on_connected_;
   StateCallback on_disconnected_;
 
-  std::string message_buffer_;
+  MessageAssembler assembler_;
+  std::unique_ptr<TinflInflater> inflater_;
 };
 
 }  // namespace transit_tracker
@@ -0,0 +1,128 @@
+// Throughput of the text and message parsers on the device's hot receive path.
+//   bench_parsers --benchmark_filter=Assembler
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "json_scan.h"
+#include "message_assembler.h"
+#include "string_utils.h"
+#include "zlib_codec.h"
+
+using namespace esphome::transit_tracker;
+
+static std::string read_data(const char *name) {
+  std::ifstream file(std::string(TT_DATA_DIR) + "/" + name, std::ios::binary);
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+static std::string import_text(size_t lines) {
+  std::string text;
+  for (size_t i = 0; i < lines; i++) {
+    text += "route_" + std::to_string(i) + ";Route " + std::to_string(i) + ";" + "a0b1c2\n";
+  }
+  return text;
+}
+
+static void BM_SplitImportLines(benchmark::State &state) {
+  const std::string text = import_text(state.range(0));
+  for (auto _ : state) {
+    Tokenizer lines(text, '\n');
+    std::string_view line;
+    std::string_view parts[3];
+    size_t fields = 0;
+    while (lines.next(line)) {
+      fields += split_fields(line, ';', parts, 3);
+    }
+    benchmark::DoNotOptimize(fields);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_SplitImportLines)->Arg(100)->Arg(2000);
+
+static void BM_ParseHexColor(benchmark::State &state) {
+  const char *const colors[] = {"ff4040", "0000FF", "a0b1c2", "zz0000", "1234567"};
+  uint32_t color = 0;
+  for (auto _ : state) {
+    for (const char *c : colors) {
+      benchmark::DoNotOptimize(parse_hex_color(c, color));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * 5);
+}
+BENCHMARK(BM_ParseHexColor);
+
+static void BM_PeekEvent(benchmark::State &state) {
+  const std::string message = read_data("schedule_large.json");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(peek_event(message.data(), message.size()));
+  }
+}
+BENCHMARK(BM_PeekEvent);
+
+static void BM_FindLeadingTrips(benchmark::State &state) {
+  const std::string message = read_data("schedule_large.json");
+  size_t array_start, array_end;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(find_leading_trips(message.data(), message.size(), state.range(0), array_start, array_end));
+  }
+}
+BENCHMARK(BM_FindLeadingTrips)->Arg(3)->Arg(100);
+
+// Looking for the first 100 trips after every 1 KiB fragment of a large schedule,
+// rescanning from the start each time (arg 0) or resuming (arg 1)
+static void BM_ScanFragments(benchmark::State &state) {
+  const std::string message = read_data("schedule_large.json");
+  const bool resume = state.range(0) != 0;
+  size_t array_start, array_end;
+  for (auto _ : state) {
+    LeadingTripScanner scanner;
+    scanner.reset(100);
+    for (size_t len = 1024; len < message.size(); len += 1024) {
+      if (resume) {
+        scanner.scan(message.data(), len);
+        if (scanner.trips() != TripScan::PENDING) {
+          break;
+        }
+      } else if (find_leading_trips(message.data(), len, 100, array_start, array_end) != TripScan::PENDING) {
+        break;
+      }
+    }
+  }
+}
+BENCHMARK(BM_ScanFragments)->Arg(0)->Arg(1);
+
+// Reassembly of a large schedule arriving in receive-buffer sized chunks
+static void BM_AssemblerFeed(benchmark::State &state) {
+  const std::string message = read_data("schedule_large.json");
+  const bool compressed = state.range(1) != 0;
+  const std::string wire = compressed ? transit_tracker_test::deflate_message(message) : message;
+  const size_t chunk_size = state.range(0);
+
+  transit_tracker_test::ZlibInflater inflater;
+  MessageAssembler assembler;
+  if (compressed) {
+    assembler.set_inflater(&inflater);
+  }
+  size_t delivered = 0;
+  assembler.set_on_message([&delivered](const BulkString &m) { delivered += m.size(); });
+
+  for (auto _ : state) {
+    for (size_t offset = 0; offset < wire.size(); offset += chunk_size) {
+      size_t len = std::min(chunk_size, wire.size() - offset);
+      assembler.feed(FrameChunk{0x01, true, static_cast<int>(wire.size()), static_cast<int>(offset),
+                                wire.data() + offset, static_cast<int>(len)});
+    }
+  }
+  if (delivered != message.size() * state.iterations()) {
+    state.SkipWithError("message was not delivered intact");
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+BENCHMARK(BM_AssemblerFeed)->Args({1024, 0})->Args({4096, 0})->Args({1024, 1})->Args({4096, 1});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,15 @@
+// parse_hex_color over arbitrary route color strings from the server or a text import.
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include "string_utils.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  std::string_view str(reinterpret_cast<const char *>(data), size);
+  uint32_t color = 0xDEADBEEF;
+  if (parse_hex_color(str, color) && (size == 0 || size > 6 || color > 0xFFFFFF)) {
+    abort();
+  }
+  return 0;
+}
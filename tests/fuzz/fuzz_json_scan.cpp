@@ -0,0 +1,46 @@
+// peek_event and find_leading_trips over every prefix of an arbitrary message,
+// the way they see a message that is still arriving, checked against a
+// LeadingTripScanner fed the same prefixes one after another.
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include "json_scan.h"
+
+using namespace esphome::transit_tracker;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  const size_t count = data[0] % 8 + 1;
+  const char *json = reinterpret_cast<const char *>(data) + 1;
+  const size_t len = size - 1;
+
+  LeadingTripScanner scanner;
+  scanner.reset(count);
+  for (size_t prefix = 0; prefix <= len; prefix++) {
+    std::string_view event = peek_event(json, prefix);
+    if (!event.empty() && (event.data() < json || event.data() + event.size() > json + prefix)) {
+      abort();
+    }
+
+    size_t array_start = SIZE_MAX, array_end = SIZE_MAX;
+    if (find_leading_trips(json, prefix, count, array_start, array_end) == TripScan::FOUND &&
+        (array_start >= array_end || array_end > prefix || json[array_start] != '[' || json[array_end - 1] != '}')) {
+      abort();
+    }
+
+    // resuming must give the same answers as scanning the prefix from the start
+    scanner.scan(json, prefix);
+    TripScan trips = find_leading_trips(json, prefix, count, array_start, array_end);
+    if (scanner.trips() != trips || (trips == TripScan::FOUND && (scanner.array_start() != array_start ||
+                                                                   scanner.array_end() != array_end))) {
+      abort();
+    }
+    if (scanner.has_event() && scanner.event(json) != event) {
+      abort();
+    }
+  }
+  return 0;
+}
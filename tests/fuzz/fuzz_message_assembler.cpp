@@ -0,0 +1,72 @@
+// MessageAssembler::feed() with arbitrary chunk sequences, standing in for the
+// websocket client's DATA event handler. Each chunk is a 6 byte header followed
+// by its data:
+//   op_code, flags (bit 0: fin, bit 1: start a new frame, bit 2: disconnect first),
+//   payload_len (2 bytes), data_len (2 bytes)
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#include "esp_heap_caps.h"
+#include "message_assembler.h"
+#include "zlib_codec.h"
+
+using namespace esphome::transit_tracker;
+
+static constexpr size_t MAX_MESSAGE_SIZE = 4096;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  transit_tracker_test::ZlibInflater inflater;
+  MessageAssembler assembler;
+  assembler.set_max_message_size(MAX_MESSAGE_SIZE);
+  if (data[0] & 1) {
+    assembler.set_inflater(&inflater);
+  }
+  // a tight heap must drop messages, never abort
+  host_heap_set_largest_free_block(data[0] & 2 ? 512 : 0);
+  assembler.set_on_message([](const BulkString &message) {
+    if (message.size() > MAX_MESSAGE_SIZE) {
+      abort();
+    }
+  });
+  assembler.set_on_partial_message([](const BulkString &buffer) {
+    if (buffer.size() > MAX_MESSAGE_SIZE) {
+      abort();
+    }
+  });
+
+  size_t pos = 1;
+  int frame_offset = 0;
+  while (pos + 6 <= size) {
+    const uint8_t *header = data + pos;
+    pos += 6;
+    const int payload_len = header[2] | (header[3] << 8);
+    int data_len = header[4] | (header[5] << 8);
+    data_len = std::min<int>(data_len, size - pos);
+
+    if (header[1] & 4) {
+      assembler.reset();
+    }
+    if (header[1] & 2) {
+      frame_offset = 0;
+    }
+
+    assembler.feed(FrameChunk{
+        .op_code = static_cast<uint8_t>(header[0] & 0x0f),
+        .fin = (header[1] & 1) != 0,
+        .payload_len = payload_len,
+        .payload_offset = frame_offset,
+        .data = reinterpret_cast<const char *>(data + pos),
+        .data_len = data_len,
+    });
+    frame_offset += data_len;
+    pos += data_len;
+  }
+
+  host_heap_set_largest_free_block(0);
+  return 0;
+}
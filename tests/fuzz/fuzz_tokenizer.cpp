@@ -0,0 +1,38 @@
+// Tokenizer and split_fields over arbitrary text, as used for the imported
+// abbreviation and route style lists.
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include "string_utils.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  const char delim = static_cast<char>(data[0]);
+  std::string_view text(reinterpret_cast<const char *>(data) + 1, size - 1);
+
+  size_t tokens = 0;
+  size_t covered = 0;
+  Tokenizer tokenizer(text, delim);
+  std::string_view token;
+  while (tokenizer.next(token)) {
+    // every token is a view into the input and never contains the delimiter
+    if (token.data() < text.data() || token.data() + token.size() > text.data() + text.size() ||
+        token.find(delim) != std::string_view::npos) {
+      abort();
+    }
+    covered += token.size() + 1;
+    tokens++;
+  }
+  if (covered < text.size()) {
+    abort();
+  }
+
+  std::string_view fields[3];
+  if (split_fields(text, delim, fields, 3) != tokens) {
+    abort();
+  }
+  return 0;
+}
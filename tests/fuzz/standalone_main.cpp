@@ -0,0 +1,37 @@
+// Runs a fuzz target over corpus files without libFuzzer, so the corpus doubles
+// as a regression test on compilers that don't support -fsanitize=fuzzer.
+//   fuzz_target FILE_OR_DIR...
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static void run_file(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+int main(int argc, char **argv) {
+  size_t runs = 0;
+  for (int i = 1; i < argc; i++) {
+    std::filesystem::path path(argv[i]);
+    if (std::filesystem::is_directory(path)) {
+      for (const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        if (entry.is_regular_file()) {
+          run_file(entry.path());
+          runs++;
+        }
+      }
+    } else {
+      run_file(path);
+      runs++;
+    }
+  }
+  std::printf("%zu inputs ran without a crash\n", runs);
+  return 0;
+}
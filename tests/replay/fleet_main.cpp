@@ -0,0 +1,92 @@
+// Runs a fleet of signs against one server stand-in and reports reconnect storms,
+// subscribe latency and memory per sign, e.g.
+//   fleet_load --clients=500 --restart-at=60 --restart-for=20 --subscribe-ms=40
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "fleet_sim.h"
+#include "session_replay.h"
+
+using transit_tracker_test::FleetConfig;
+
+static void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [options]\n"
+               "  --clients=N               signs in the fleet (300)\n"
+               "  --duration=S              virtual seconds to run (300)\n"
+               "  --restart-at=S            when the server restarts; -1 for never (60)\n"
+               "  --restart-for=S           how long it refuses connections (10)\n"
+               "  --handshake-ms=MS         server time per connection attempt (5)\n"
+               "  --subscribe-ms=MS         server time per subscribe (20)\n"
+               "  --network-timeout-ms=MS   attempts not accepted by then fail (10000)\n"
+               "  --reconnect-delay-ms=MS   first retry delay (5000)\n"
+               "  --max-reconnect-delay-ms=MS  backoff cap (30000)\n"
+               "  --push-interval=S         schedule updates per sign (30)\n"
+               "  --heartbeat-interval=S    heartbeats per sign (15)\n"
+               "  --link=BYTES_PER_S        per-sign downlink; 0 for instant (0)\n"
+               "  --deflate                 compress messages\n"
+               "  --limit=N                 rows each sign shows (3)\n"
+               "  --schedule=FILE           schedule message (tests/data/schedule_small.json)\n"
+               "  --seed=N                  jitter seed (1)\n",
+               argv0);
+}
+
+int main(int argc, char **argv) {
+  FleetConfig config;
+  std::string schedule_file = std::string(TT_DATA_DIR) + "/schedule_small.json";
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    std::string name = arg.substr(0, eq);
+    const char *value = eq != std::string::npos ? argv[i] + eq + 1 : "";
+
+    if (name == "--clients") {
+      config.clients = std::strtoul(value, nullptr, 10);
+    } else if (name == "--duration") {
+      config.duration_ms = std::atof(value) * 1000;
+    } else if (name == "--restart-at") {
+      config.restart_at_ms = std::atof(value) * 1000;
+    } else if (name == "--restart-for") {
+      config.restart_ms = std::atof(value) * 1000;
+    } else if (name == "--handshake-ms") {
+      config.handshake_cost_ms = std::atof(value);
+    } else if (name == "--subscribe-ms") {
+      config.subscribe_cost_ms = std::atof(value);
+    } else if (name == "--network-timeout-ms") {
+      config.network_timeout_ms = std::atof(value);
+    } else if (name == "--reconnect-delay-ms") {
+      config.reconnect_delay_ms = std::strtoul(value, nullptr, 10);
+    } else if (name == "--max-reconnect-delay-ms") {
+      config.max_reconnect_delay_ms = std::strtoul(value, nullptr, 10);
+    } else if (name == "--push-interval") {
+      config.push_interval_ms = std::atof(value) * 1000;
+    } else if (name == "--heartbeat-interval") {
+      config.heartbeat_interval_ms = std::atof(value) * 1000;
+    } else if (name == "--link") {
+      config.link_bps = std::atof(value);
+    } else if (name == "--deflate") {
+      config.deflate = true;
+    } else if (name == "--limit") {
+      config.limit = std::atoi(value);
+    } else if (name == "--schedule") {
+      schedule_file = value;
+    } else if (name == "--seed") {
+      config.seed = std::strtoul(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (!transit_tracker_test::read_file(schedule_file, config.schedule)) {
+    std::fprintf(stderr, "can't read %s\n", schedule_file.c_str());
+    return 2;
+  }
+
+  auto result = transit_tracker_test::run_fleet(config);
+  transit_tracker_test::print_fleet_report(config, result, stdout);
+  return 0;
+}
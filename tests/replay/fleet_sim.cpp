@@ -0,0 +1,480 @@
+#include "fleet_sim.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+
+#include "esp_heap_caps.h"
+#include "esphome/core/hal.h"
+
+#include "json_scan.h"
+#include "message_assembler.h"
+#include "reconnect_policy.h"
+#include "schedule_feed.h"
+#include "schedule_state.h"
+#include "session_replay.h"
+#include "zlib_codec.h"
+
+namespace transit_tracker_test {
+
+using esphome::transit_tracker::BulkString;
+using esphome::transit_tracker::BulkVector;
+using esphome::transit_tracker::ConnectionMonitor;
+using esphome::transit_tracker::FrameChunk;
+using esphome::transit_tracker::MessageAssembler;
+using esphome::transit_tracker::ReconnectBackoff;
+using esphome::transit_tracker::RecoveryAction;
+using esphome::transit_tracker::ScheduleFeed;
+using esphome::transit_tracker::ScheduleState;
+using esphome::transit_tracker::Trip;
+
+// millis() when the run starts; 0 is reserved for "never" by the code under test
+static constexpr uint32_t RUN_START_MS = 10000;
+// How often every sign's main loop checks its ConnectionMonitor. Coarser than the
+// device's loop so large fleets stay cheap, still far finer than the thresholds.
+static constexpr double RECOVERY_CHECK_INTERVAL_MS = 250;
+// From a reboot until the sign starts connecting again
+static constexpr double BOOT_MS = 5000;
+
+static constexpr uint8_t OP_TEXT = 0x01;
+static const char *const HEARTBEAT_MESSAGE = "{\"event\":\"heartbeat\",\"data\":null}";
+
+namespace {
+
+enum class EventType {
+  ATTEMPT,
+  ACCEPTED,
+  TIMED_OUT,
+  SUBSCRIBED,
+  CHUNK,
+  PUSH,
+  HEARTBEAT,
+  RECOVERY_CHECK,
+  SERVER_DOWN,
+  SERVER_UP,
+};
+
+struct Event {
+  double at;
+  uint64_t seq;  // keeps events due at the same time in the order they were scheduled
+  EventType type;
+  size_t client;
+  uint32_t connection;  // the client's connection it belongs to; events for an earlier one are dropped
+
+  bool operator>(const Event &other) const { return at != other.at ? at > other.at : seq > other.seq; }
+};
+
+/// One sign's client side, wired the way TransitTracker::setup() wires it.
+struct Client {
+  MessageAssembler assembler;
+  std::unique_ptr<ZlibInflater> inflater;
+  ScheduleState state;
+  ScheduleFeed feed{state};
+  ConnectionMonitor monitor;
+  ReconnectBackoff backoff;
+  uint32_t reconnect_delay_ms = 0;  // configured on its esp_websocket_client
+
+  bool attempting = false;
+  bool connected = false;
+  uint32_t connection = 0;    // bumped whenever an attempt or connection ends
+  double subscribed_at = -1;  // when the connect message went out, until its trips are visible
+  bool showed_error = false;  // during the current outage
+  bool recovered = true;      // showed trips since the last server restart
+
+  // Messages queued on the downlink, with how many bytes of the front one have arrived
+  std::deque<std::pair<std::shared_ptr<const std::string>, size_t>> downlink;
+
+  // Bulk heap the message being received added so far, and the most it reached
+  int64_t message_bytes = 0;
+  int64_t message_peak = 0;
+};
+
+class Fleet {
+ public:
+  Fleet(const FleetConfig &config, FleetResult &result) : config_(config), result_(result), random_(config.seed) {
+    schedule_wire_ = std::make_shared<const std::string>(wire_(config.schedule));
+    heartbeat_wire_ = std::make_shared<const std::string>(wire_(HEARTBEAT_MESSAGE));
+  }
+
+  void run();
+
+ protected:
+  std::string wire_(const std::string &payload) const {
+    return config_.deflate ? deflate_message(payload) : payload;
+  }
+
+  uint32_t next_random_() {
+    random_ = random_ * 1664525 + 1013904223;
+    return random_;
+  }
+  double uniform_(double range) { return (next_random_() >> 8) * range / (1u << 24); }
+
+  void schedule_(double at, EventType type, size_t client = 0, uint32_t connection = 0) {
+    events_.push(Event{at, next_seq_++, type, client, connection});
+  }
+  double transfer_ms_(size_t bytes) const { return config_.link_bps > 0 ? bytes * 1000.0 / config_.link_bps : 0; }
+  // Server work runs one job at a time; returns when this one finishes
+  double server_job_(double cost_ms) {
+    server_free_at_ = std::max(now_ms_, server_free_at_) + cost_ms;
+    return server_free_at_;
+  }
+
+  void add_client_();
+  void handle_(const Event &event);
+  void attempt_(size_t id);
+  void accepted_(size_t id);
+  void end_connection_(size_t id, bool attempt_failed);
+  void reboot_(size_t id);
+  void send_(size_t id, const std::shared_ptr<const std::string> &wire);
+  void receive_chunk_(size_t id);
+  void published_(size_t id);
+  void check_recovery_();
+  void server_down_();
+
+  const FleetConfig &config_;
+  FleetResult &result_;
+  std::vector<std::unique_ptr<Client>> clients_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<>> events_;
+  uint64_t next_seq_ = 0;
+  double now_ms_ = 0;
+  uint32_t random_;
+
+  bool server_up_ = true;
+  double server_free_at_ = 0;
+  double server_up_at_ = -1;
+  size_t recovered_ = 0;
+
+  std::shared_ptr<const std::string> schedule_wire_;
+  std::shared_ptr<const std::string> heartbeat_wire_;
+};
+
+void Fleet::run() {
+  esphome::host_set_millis(RUN_START_MS);
+  const size_t heap_before = host_heap_get_allocated();
+
+  for (size_t id = 0; id < config_.clients; id++) {
+    add_client_();
+    schedule_(uniform_(config_.boot_spread_ms), EventType::ATTEMPT, id);
+  }
+  schedule_(RECOVERY_CHECK_INTERVAL_MS, EventType::RECOVERY_CHECK);
+  if (config_.restart_at_ms >= 0) {
+    schedule_(config_.restart_at_ms, EventType::SERVER_DOWN);
+  }
+
+  while (!events_.empty() && events_.top().at <= config_.duration_ms) {
+    Event event = events_.top();
+    events_.pop();
+    now_ms_ = event.at;
+    esphome::host_set_millis(RUN_START_MS + static_cast<uint32_t>(now_ms_));
+    handle_(event);
+  }
+
+  result_.clients = config_.clients;
+  if (config_.clients > 0) {
+    result_.retained_bytes_per_client = (host_heap_get_allocated() - heap_before) / config_.clients;
+  }
+}
+
+void Fleet::add_client_() {
+  const size_t id = clients_.size();
+  clients_.push_back(std::make_unique<Client>());
+  Client &c = *clients_.back();
+
+  c.backoff.set_base_delay_ms(config_.reconnect_delay_ms);
+  c.backoff.set_max_delay_ms(config_.max_reconnect_delay_ms);
+  // start(): what the first retry will wait
+  c.reconnect_delay_ms = c.backoff.on_connected(next_random_());
+
+  c.feed.set_limit(config_.limit);
+  c.feed.build_filter();
+  c.feed.set_on_heartbeat([this]() { result_.heartbeats++; });
+  c.feed.set_on_parse_error([this]() { result_.parse_errors++; });
+  c.feed.set_on_published([this, id](uint32_t) { published_(id); });
+
+  if (config_.deflate) {
+    c.inflater = std::make_unique<ZlibInflater>();
+    c.assembler.set_inflater(c.inflater.get());
+  }
+  c.assembler.set_on_message_start([&c]() { c.feed.on_message_start(); });
+  c.assembler.set_on_partial_message([&c](const BulkString &buffer) { c.feed.handle_partial_message(buffer); });
+  c.assembler.set_on_message([this, &c](const BulkString &message) {
+    if (esphome::transit_tracker::peek_event(message.data(), message.size()) == "schedule") {
+      result_.schedules++;
+    }
+    c.feed.handle_message(message);
+  });
+}
+
+void Fleet::handle_(const Event &event) {
+  if (event.type == EventType::RECOVERY_CHECK) {
+    check_recovery_();
+    schedule_(now_ms_ + RECOVERY_CHECK_INTERVAL_MS, EventType::RECOVERY_CHECK);
+    return;
+  }
+  if (event.type == EventType::SERVER_DOWN) {
+    server_down_();
+    return;
+  }
+  if (event.type == EventType::SERVER_UP) {
+    server_up_ = true;
+    server_up_at_ = now_ms_;
+    return;
+  }
+
+  Client &c = *clients_[event.client];
+  if (event.connection != c.connection) {
+    return;  // that attempt or connection has ended
+  }
+
+  switch (event.type) {
+    case EventType::ATTEMPT:
+      attempt_(event.client);
+      break;
+    case EventType::ACCEPTED:
+      accepted_(event.client);
+      break;
+    case EventType::TIMED_OUT:
+      end_connection_(event.client, true);
+      break;
+    case EventType::SUBSCRIBED:
+      send_(event.client, schedule_wire_);
+      schedule_(now_ms_ + config_.push_interval_ms, EventType::PUSH, event.client, c.connection);
+      schedule_(now_ms_ + config_.heartbeat_interval_ms, EventType::HEARTBEAT, event.client, c.connection);
+      break;
+    case EventType::CHUNK:
+      receive_chunk_(event.client);
+      break;
+    case EventType::PUSH:
+      send_(event.client, schedule_wire_);
+      schedule_(now_ms_ + config_.push_interval_ms, EventType::PUSH, event.client, c.connection);
+      break;
+    case EventType::HEARTBEAT:
+      send_(event.client, heartbeat_wire_);
+      schedule_(now_ms_ + config_.heartbeat_interval_ms, EventType::HEARTBEAT, event.client, c.connection);
+      break;
+    default:
+      break;
+  }
+}
+
+void Fleet::attempt_(size_t id) {
+  Client &c = *clients_[id];
+  result_.attempts++;
+  size_t second = static_cast<size_t>(now_ms_ / 1000);
+  if (result_.attempts_per_s.size() <= second) {
+    result_.attempts_per_s.resize(second + 1);
+  }
+  result_.attempts_per_s[second]++;
+
+  c.attempting = true;
+  if (!server_up_) {
+    end_connection_(id, true);  // refused
+    return;
+  }
+
+  // The server spends the handshake even on an attempt that gives up waiting for it
+  double accepted_at = server_job_(config_.handshake_cost_ms);
+  if (accepted_at - now_ms_ > config_.network_timeout_ms) {
+    schedule_(now_ms_ + config_.network_timeout_ms, EventType::TIMED_OUT, id, c.connection);
+  } else {
+    schedule_(accepted_at, EventType::ACCEPTED, id, c.connection);
+  }
+}
+
+void Fleet::accepted_(size_t id) {
+  Client &c = *clients_[id];
+  c.attempting = false;
+  c.connected = true;
+  c.showed_error = false;
+  c.monitor.on_connected();
+  c.reconnect_delay_ms = c.backoff.on_connected(next_random_());
+
+  // The websocket task sends the connect message straight away; the server answers in turn
+  c.subscribed_at = now_ms_;
+  schedule_(server_job_(config_.subscribe_cost_ms), EventType::SUBSCRIBED, id, c.connection);
+}
+
+void Fleet::end_connection_(size_t id, bool attempt_failed) {
+  Client &c = *clients_[id];
+  if (attempt_failed) {
+    result_.failed_attempts++;
+  }
+  c.attempting = false;
+  c.connected = false;
+  c.connection++;
+  c.subscribed_at = -1;
+  c.downlink.clear();
+  c.assembler.reset();
+  c.message_bytes = c.message_peak = 0;
+  c.monitor.on_disconnected();
+
+  // esp_websocket_client waits the delay configured before this failure; the
+  // handler configures the one after
+  uint32_t wait = c.reconnect_delay_ms;
+  c.reconnect_delay_ms = c.backoff.on_disconnected(next_random_());
+  schedule_(now_ms_ + wait, EventType::ATTEMPT, id, c.connection);
+}
+
+void Fleet::reboot_(size_t id) {
+  Client &c = *clients_[id];
+  result_.reboots++;
+  c.attempting = false;
+  c.connected = false;
+  c.connection++;
+  c.subscribed_at = -1;
+  c.showed_error = false;
+  c.downlink.clear();
+  c.assembler.reset();
+  c.message_bytes = c.message_peak = 0;
+  {
+    std::lock_guard<std::mutex> lock(c.state.mutex);
+    c.state.replace(BulkVector<Trip>());
+  }
+  c.monitor.on_connected();  // a fresh boot has no outage behind it
+  c.reconnect_delay_ms = c.backoff.on_connected(next_random_());
+  schedule_(now_ms_ + BOOT_MS, EventType::ATTEMPT, id, c.connection);
+}
+
+void Fleet::send_(size_t id, const std::shared_ptr<const std::string> &wire) {
+  Client &c = *clients_[id];
+  c.downlink.emplace_back(wire, 0);
+  if (c.downlink.size() == 1) {
+    size_t first = std::min(config_.buffer_size, wire->size());
+    schedule_(now_ms_ + transfer_ms_(first), EventType::CHUNK, id, c.connection);
+  }
+}
+
+void Fleet::receive_chunk_(size_t id) {
+  Client &c = *clients_[id];
+  auto &[wire, sent] = c.downlink.front();
+  const size_t len = std::min(config_.buffer_size, wire->size() - sent);
+
+  // Only this sign's pipeline runs during feed(), so the heap it grows by is its own
+  const size_t before = host_heap_get_allocated();
+  host_heap_reset_peak();
+  c.assembler.feed(FrameChunk{
+      .op_code = OP_TEXT,
+      .fin = true,
+      .payload_len = static_cast<int>(wire->size()),
+      .payload_offset = static_cast<int>(sent),
+      .data = wire->data() + sent,
+      .data_len = static_cast<int>(len),
+  });
+  c.message_peak = std::max<int64_t>(c.message_peak,
+                                     c.message_bytes + static_cast<int64_t>(host_heap_get_peak_allocated() - before));
+  c.message_bytes += static_cast<int64_t>(host_heap_get_allocated()) - static_cast<int64_t>(before);
+  if (!c.assembler.is_receiving()) {
+    result_.peak_message_bytes = std::max(result_.peak_message_bytes, static_cast<size_t>(c.message_peak));
+    c.message_bytes = c.message_peak = 0;
+  }
+
+  sent += len;
+  if (sent == wire->size()) {
+    c.downlink.pop_front();
+  }
+  if (!c.downlink.empty()) {
+    const auto &[next, next_sent] = c.downlink.front();
+    size_t next_len = std::min(config_.buffer_size, next->size() - next_sent);
+    schedule_(now_ms_ + transfer_ms_(next_len), EventType::CHUNK, id, c.connection);
+  }
+}
+
+void Fleet::published_(size_t id) {
+  Client &c = *clients_[id];
+  if (c.subscribed_at >= 0) {
+    result_.subscribe_ms.push_back(now_ms_ - c.subscribed_at);
+    c.subscribed_at = -1;
+  }
+  if (!c.recovered && server_up_at_ >= 0) {
+    c.recovered = true;
+    if (++recovered_ == clients_.size()) {
+      result_.recovered_ms = now_ms_ - server_up_at_;
+    }
+  }
+}
+
+void Fleet::check_recovery_() {
+  // What each sign's TransitTracker::check_connection_recovery_() decides this loop
+  for (size_t id = 0; id < clients_.size(); id++) {
+    Client &c = *clients_[id];
+    switch (c.monitor.check()) {
+      case RecoveryAction::REBOOT:
+        reboot_(id);
+        break;
+      case RecoveryAction::REPORT_ERROR:
+        if (!c.showed_error) {
+          c.showed_error = true;
+          result_.errors++;
+        }
+        break;
+      case RecoveryAction::NONE:
+        break;
+    }
+  }
+}
+
+void Fleet::server_down_() {
+  server_up_ = false;
+  server_free_at_ = now_ms_;  // queued handshakes and subscribes are lost with it
+  recovered_ = 0;
+  for (size_t id = 0; id < clients_.size(); id++) {
+    Client &c = *clients_[id];
+    c.recovered = false;
+    if (c.connected || c.attempting) {
+      end_connection_(id, c.attempting);
+    }
+  }
+  schedule_(now_ms_ + config_.restart_ms, EventType::SERVER_UP);
+}
+
+}  // namespace
+
+size_t FleetResult::peak_attempts_per_s(double from_ms, double *at_ms) const {
+  size_t peak = 0;
+  for (size_t second = static_cast<size_t>(from_ms / 1000); second < attempts_per_s.size(); second++) {
+    if (attempts_per_s[second] > peak) {
+      peak = attempts_per_s[second];
+      if (at_ms != nullptr) {
+        *at_ms = second * 1000.0;
+      }
+    }
+  }
+  return peak;
+}
+
+FleetResult run_fleet(const FleetConfig &config) {
+  FleetResult result;
+  Fleet(config, result).run();
+  return result;
+}
+
+void print_fleet_report(const FleetConfig &config, const FleetResult &result, FILE *out) {
+  double peak_at = 0;
+  size_t peak = result.peak_attempts_per_s(0, &peak_at);
+  std::fprintf(out, "  %zu signs: %zu connection attempts (%zu failed), peak %zu attempts/s at %.0f s\n",
+               result.clients, result.attempts, result.failed_attempts, peak, peak_at / 1000);
+  if (config.restart_at_ms >= 0) {
+    size_t storm = result.peak_attempts_per_s(config.restart_at_ms, &peak_at);
+    std::fprintf(out, "  server restart at %.0f s: peak %zu attempts/s at %.0f s", config.restart_at_ms / 1000, storm,
+                 peak_at / 1000);
+    if (result.recovered_ms >= 0) {
+      std::fprintf(out, ", every sign showed trips again %.1f s after it came back", result.recovered_ms / 1000);
+    }
+    std::fprintf(out, "\n");
+  }
+  if (!result.subscribe_ms.empty()) {
+    std::fprintf(out, "  subscribe to trips visible: p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+                 percentile(result.subscribe_ms, 0.5), percentile(result.subscribe_ms, 0.9),
+                 percentile(result.subscribe_ms, 0.99), percentile(result.subscribe_ms, 1.0));
+  }
+  std::fprintf(out, "  %zu schedules, %zu heartbeats, %zu parse errors, %zu error states, %zu reboots\n",
+               result.schedules, result.heartbeats, result.parse_errors, result.errors, result.reboots);
+  std::fprintf(out, "  bulk heap per sign: %zu bytes between messages, up to %zu more while handling one\n",
+               result.retained_bytes_per_client, result.peak_message_bytes);
+}
+
+}  // namespace transit_tracker_test
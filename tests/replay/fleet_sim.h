@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace transit_tracker_test {
+
+/// A fleet of signs sharing one server. Times are virtual milliseconds since the start of the run.
+struct FleetConfig {
+  size_t clients = 300;
+  double duration_ms = 300000;
+  double boot_spread_ms = 1000;  // signs power up at random times within this window
+
+  // The server restarts at `restart_at_ms` (negative: never), dropping every
+  // connection and refusing new ones for `restart_ms`
+  double restart_at_ms = 60000;
+  double restart_ms = 10000;
+
+  // The server works through connection handshakes and subscribes one at a time
+  double handshake_cost_ms = 5;
+  double subscribe_cost_ms = 20;
+  // An attempt the server hasn't accepted by then fails, as network_timeout_ms does on the device
+  double network_timeout_ms = 10000;
+
+  uint32_t reconnect_delay_ms = 5000;
+  uint32_t max_reconnect_delay_ms = 30000;
+
+  double push_interval_ms = 30000;  // schedule updates to each connected sign
+  double heartbeat_interval_ms = 15000;
+  double link_bps = 0;  // per-sign downlink; 0 = instant
+  size_t buffer_size = 4096;
+  bool deflate = false;
+  int limit = 3;
+  std::string schedule;  // the schedule message sent on subscribe and every push
+
+  uint32_t seed = 1;
+};
+
+struct FleetResult {
+  size_t clients = 0;
+  size_t attempts = 0;         // connection attempts, the first ones included
+  size_t failed_attempts = 0;  // refused while the server was down, or timed out in its queue
+  std::vector<size_t> attempts_per_s;  // attempts reaching the server in each second of the run
+  double recovered_ms = -1;  // from the server coming back until every sign showed trips again; -1 if never
+
+  std::vector<double> subscribe_ms;  // from each connect until the subscribed schedule's trips were visible
+  size_t schedules = 0;
+  size_t heartbeats = 0;
+  size_t parse_errors = 0;
+  size_t errors = 0;   // outages that raised the error status
+  size_t reboots = 0;
+
+  // Bulk heap (what the device places in PSRAM when it has it)
+  size_t retained_bytes_per_client = 0;  // held between messages, averaged over the fleet
+  size_t peak_message_bytes = 0;         // the most one sign needed on top of that while handling a message
+
+  /// The most attempts in any one second from `from_ms` on, and which second that was.
+  size_t peak_attempts_per_s(double from_ms, double *at_ms = nullptr) const;
+};
+
+/// Runs every sign's client pipeline in one event loop on a virtual clock: MessageAssembler,
+/// ScheduleFeed into a ScheduleState, ReconnectBackoff as esp_websocket_client applies it,
+/// and ConnectionMonitor deciding on errors and reboots. The server stand-in is a single
+/// work queue, so a reconnect storm shows up as queueing, timeouts and retries.
+FleetResult run_fleet(const FleetConfig &config);
+
+void print_fleet_report(const FleetConfig &config, const FleetResult &result, FILE *out);
+
+}  // namespace transit_tracker_test
@@ -0,0 +1,21 @@
+// Replays recorded session scripts and prints per-message latency, e.g.
+//   replay_session tests/sessions/*.session
+#include <cstdio>
+
+#include "session_replay.h"
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s SESSION...\n", argv[0]);
+    return 2;
+  }
+
+  int failed = 0;
+  for (int i = 1; i < argc; i++) {
+    std::printf("%s\n", argv[i]);
+    auto result = transit_tracker_test::replay_session_file(argv[i]);
+    transit_tracker_test::print_report(result, stdout);
+    failed += result.failures.empty() ? 0 : 1;
+  }
+  return failed == 0 ? 0 : 1;
+}
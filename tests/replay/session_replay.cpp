@@ -0,0 +1,470 @@
+#include "session_replay.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include "esphome/core/hal.h"
+
+#include "json_scan.h"
+#include "message_assembler.h"
+#include "reconnect_policy.h"
+#include "schedule_feed.h"
+#include "schedule_state.h"
+#include "zlib_codec.h"
+
+namespace transit_tracker_test {
+
+using esphome::transit_tracker::BulkString;
+using esphome::transit_tracker::FrameChunk;
+using esphome::transit_tracker::MessageAssembler;
+using esphome::transit_tracker::RecoveryAction;
+
+// millis() when the session starts; 0 is reserved for "never" by the code under test
+static constexpr uint32_t SESSION_START_MS = 10000;
+// How often the main loop runs check_connection_recovery_() (ESPHome's default loop interval)
+static constexpr double LOOP_INTERVAL_MS = 16;
+
+static constexpr uint8_t OP_CONTINUATION = 0x00;
+static constexpr uint8_t OP_TEXT = 0x01;
+static constexpr uint8_t OP_CLOSE = 0x08;
+static constexpr uint8_t OP_PING = 0x09;
+
+size_t ReplayResult::delivered() const {
+  return std::count_if(messages.begin(), messages.end(), [](const MessageTrace &m) { return m.delivered(); });
+}
+
+size_t ReplayResult::errors() const {
+  return std::count_if(outages.begin(), outages.end(), [](const OutageTrace &o) { return o.error_ms >= 0; });
+}
+
+size_t ReplayResult::reboots() const {
+  return std::count_if(outages.begin(), outages.end(), [](const OutageTrace &o) { return o.reboot_ms >= 0; });
+}
+
+size_t ReplayResult::dropped() const { return messages.size() - delivered(); }
+
+size_t ReplayResult::shown_early() const {
+  return std::count_if(messages.begin(), messages.end(), [](const MessageTrace &m) { return m.shown_early(); });
+}
+
+bool read_file(const std::string &path, std::string &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  out = contents.str();
+  return true;
+}
+
+namespace {
+
+/// The server side of a session plus the client pipeline it feeds.
+class Replay {
+ public:
+  Replay(std::string base_dir, ReplayResult &result) : base_dir_(std::move(base_dir)), result_(result) {
+    esphome::host_set_millis(SESSION_START_MS);
+    reconnect_delay_ms_ = backoff_.on_connected(next_random_());
+
+    // Wired up the way TransitTracker::setup() does it, minus the device-only parts
+    feed_.set_limit(limit_);
+    feed_.build_filter();
+    feed_.set_on_heartbeat([this]() { result_.heartbeats++; });
+    feed_.set_on_parse_error([this]() { result_.parse_errors++; });
+    feed_.set_on_published([this](uint32_t) {
+      MessageTrace &trace = result_.messages.back();
+      if (trace.visible_ms < 0) {
+        trace.visible_ms = now_ms_;
+      }
+    });
+
+    assembler_.set_on_message_start([this]() {
+      MessageTrace trace;
+      trace.first_chunk_ms = chunk_sent_ms_;
+      result_.messages.push_back(trace);
+      feed_.on_message_start();
+    });
+    assembler_.set_on_partial_message([this](const BulkString &buffer) { feed_.handle_partial_message(buffer); });
+    assembler_.set_on_message([this](const BulkString &message) {
+      MessageTrace &trace = result_.messages.back();
+      trace.delivered_ms = now_ms_;
+      trace.message_bytes = message.size();
+      trace.event = std::string(esphome::transit_tracker::peek_event(message.data(), message.size()));
+      feed_.handle_message(message);
+    });
+  }
+
+  void run_line(const std::string &line, size_t line_number);
+
+ protected:
+  void fail_(size_t line_number, const std::string &message) {
+    result_.failures.push_back("line " + std::to_string(line_number) + ": " + message);
+  }
+
+  void advance_(double ms) {
+    now_ms_ += ms;
+    esphome::host_set_millis(SESSION_START_MS + static_cast<uint32_t>(now_ms_));
+  }
+
+  uint32_t next_random_() {
+    random_state_ = random_state_ * 1664525 + 1013904223;
+    return random_state_;
+  }
+
+  // The connection drops: what WebSocketClient and TransitTracker::on_disconnect_() do
+  void drop_() {
+    assembler_.reset();
+    monitor_.on_disconnected();
+    result_.disconnects++;
+  }
+
+  // Like esp_websocket_client: the delay configured before this failure is the one
+  // waited, and the handler configures the next. Returns the wait.
+  uint32_t latch_reconnect_delay_() {
+    uint32_t wait = reconnect_delay_ms_;
+    reconnect_delay_ms_ = backoff_.on_disconnected(next_random_());
+    return wait;
+  }
+
+  void connected_() {
+    monitor_.on_connected();
+    reconnect_delay_ms_ = backoff_.on_connected(next_random_());
+  }
+
+  void send_frame_(uint8_t op, bool fin, const std::string &frame, size_t truncate_at, size_t &sent) {
+    size_t offset = 0;
+    do {
+      size_t len = std::min(buffer_size_, frame.size() - offset);
+      if (truncate_at != 0 && sent + len > truncate_at) {
+        len = truncate_at > sent ? truncate_at - sent : 0;
+      }
+      // a chunk is handed over once its last byte has arrived
+      chunk_sent_ms_ = now_ms_;
+      if (link_bps_ > 0) {
+        advance_(len * 1000.0 / link_bps_);
+      }
+      if (len > 0 || frame.empty()) {
+        uint32_t wire_before = assembler_.get_wire_bytes();
+        assembler_.feed(FrameChunk{
+            .op_code = op,
+            .fin = fin,
+            .payload_len = static_cast<int>(frame.size()),
+            .payload_offset = static_cast<int>(offset),
+            .data = frame.data() + offset,
+            .data_len = static_cast<int>(len),
+        });
+        if (!result_.messages.empty()) {
+          result_.messages.back().wire_bytes += assembler_.get_wire_bytes() - wire_before;
+        }
+      }
+      offset += len;
+      sent += len;
+      if (truncate_at != 0 && sent >= truncate_at) {
+        return;
+      }
+    } while (offset < frame.size());
+  }
+
+  void send_(std::istringstream &args, size_t line_number);
+  void outage_(double duration_ms, double fail_ms);
+
+  std::string base_dir_;
+  ReplayResult &result_;
+  MessageAssembler assembler_;
+  std::unique_ptr<ZlibInflater> inflater_;
+  size_t buffer_size_ = 4096;
+  double link_bps_ = 0;
+  int limit_ = 3;
+  double now_ms_ = 0;
+  double chunk_sent_ms_ = 0;
+  esphome::transit_tracker::ScheduleState state_;
+  esphome::transit_tracker::ScheduleFeed feed_{state_};
+  esphome::transit_tracker::ConnectionMonitor monitor_;
+  esphome::transit_tracker::ReconnectBackoff backoff_;
+  uint32_t reconnect_delay_ms_ = 0;  // configured on the simulated client
+  uint32_t random_state_ = 1;        // fixed seed, so a session replays identically
+};
+
+void Replay::outage_(double duration_ms, double fail_ms) {
+  // The server is unreachable from the drop until `duration_ms` later. Each attempt is
+  // refused or times out after `fail_ms`; in between, the main loop checks the monitor
+  // the way TransitTracker::check_connection_recovery_() does.
+  OutageTrace trace;
+  trace.duration_ms = duration_ms;
+  const double start = now_ms_;
+  drop_();
+
+  double next_tick = start + LOOP_INTERVAL_MS;
+  auto run_until = [&](double until) {
+    while (next_tick <= until && trace.reboot_ms < 0) {
+      advance_(next_tick - now_ms_);
+      next_tick += LOOP_INTERVAL_MS;
+      switch (monitor_.check()) {
+        case RecoveryAction::REBOOT:
+          trace.reboot_ms = now_ms_ - start;
+          break;
+        case RecoveryAction::REPORT_ERROR:
+          if (trace.error_ms < 0) {
+            trace.error_ms = now_ms_ - start;
+          }
+          break;
+        case RecoveryAction::NONE:
+          break;
+      }
+    }
+    if (trace.reboot_ms < 0) {
+      advance_(until - now_ms_);
+    }
+  };
+
+  while (trace.reboot_ms < 0) {
+    const double attempt_at = now_ms_ + latch_reconnect_delay_();
+    if (attempt_at - start >= duration_ms) {
+      run_until(attempt_at);
+      if (trace.reboot_ms < 0) {
+        trace.reconnected_ms = now_ms_ - start;
+      }
+      break;
+    }
+    run_until(attempt_at + fail_ms);
+    if (trace.reboot_ms < 0) {
+      monitor_.on_disconnected();
+    }
+  }
+
+  if (trace.reboot_ms >= 0) {
+    // a rebooted sign is back once the server is
+    advance_(std::max(0.0, start + duration_ms - now_ms_));
+  }
+  trace.attempts = monitor_.get_attempts();
+  connected_();
+  result_.outages.push_back(trace);
+}
+
+void Replay::send_(std::istringstream &args, size_t line_number) {
+  std::map<std::string, size_t> options = {{"fragments", 1}, {"pings", 0}, {"truncate", 0}, {"garble", SIZE_MAX}};
+  std::string word;
+  std::string payload;
+  while (args >> word) {
+    size_t eq = word.find('=');
+    if (eq != std::string::npos && options.count(word.substr(0, eq))) {
+      options[word.substr(0, eq)] = std::stoul(word.substr(eq + 1));
+      continue;
+    }
+    std::string rest;
+    std::getline(args, rest);
+    payload = word + rest;
+    break;
+  }
+
+  if (!payload.empty() && payload[0] == '@' && !read_file(base_dir_ + "/" + payload.substr(1), payload)) {
+    fail_(line_number, "can't read payload file " + payload);
+    return;
+  }
+  if (payload.empty()) {
+    fail_(line_number, "send needs a payload");
+    return;
+  }
+
+  std::string wire = inflater_ ? deflate_message(payload) : payload;
+  if (options["garble"] < wire.size()) {
+    wire[options["garble"]] ^= 0x5a;
+  }
+
+  size_t fragments = std::max<size_t>(1, std::min(options["fragments"], wire.size()));
+  size_t fragment_size = (wire.size() + fragments - 1) / fragments;
+  size_t sent = 0;
+  for (size_t i = 0; i < fragments; i++) {
+    std::string frame = wire.substr(i * fragment_size, fragment_size);
+    bool last = i + 1 == fragments;
+    send_frame_(i == 0 ? OP_TEXT : OP_CONTINUATION, last, frame, options["truncate"], sent);
+    if (options["truncate"] != 0 && sent >= options["truncate"]) {
+      // the connection drops partway through the message
+      drop_();
+      return;
+    }
+    if (options["pings"] && !last) {
+      size_t ping_sent = 0;
+      send_frame_(OP_PING, true, "", 0, ping_sent);
+    }
+  }
+}
+
+void Replay::run_line(const std::string &line, size_t line_number) {
+  std::istringstream args(line.substr(0, line.find('#')));
+  std::string command;
+  if (!(args >> command)) {
+    return;
+  }
+
+  if (command == "buffer") {
+    args >> buffer_size_;
+  } else if (command == "link") {
+    args >> link_bps_;
+  } else if (command == "limit") {
+    args >> limit_;
+    feed_.set_limit(limit_);
+  } else if (command == "wait") {
+    double ms = 0;
+    args >> ms;
+    advance_(ms);
+  } else if (command == "deflate") {
+    std::string value;
+    args >> value;
+    inflater_ = value == "on" ? std::make_unique<ZlibInflater>() : nullptr;
+    assembler_.set_inflater(inflater_.get());
+  } else if (command == "send") {
+    send_(args, line_number);
+  } else if (command == "ping") {
+    size_t sent = 0;
+    send_frame_(OP_PING, true, "", 0, sent);
+  } else if (command == "close") {
+    unsigned code = 1000;
+    args >> code;
+    std::string reason;
+    std::getline(args, reason);
+    reason.erase(0, reason.find_first_not_of(' '));
+    std::string frame = {static_cast<char>(code >> 8), static_cast<char>(code & 0xff)};
+    frame += reason;
+    size_t sent = 0;
+    send_frame_(OP_CLOSE, true, frame, 0, sent);
+    result_.close_frames++;
+  } else if (command == "disconnect") {
+    drop_();
+  } else if (command == "outage") {
+    double duration_ms = 0, fail_ms = 0;
+    args >> duration_ms >> fail_ms;
+    outage_(duration_ms, fail_ms);
+  } else if (command == "connect") {
+    // nothing else carries over between connections on the client side
+    connected_();
+  } else if (command == "expect") {
+    std::string what, expected;
+    args >> what >> expected;
+    std::string actual;
+    if (what == "delivered") {
+      actual = std::to_string(result_.delivered());
+    } else if (what == "dropped") {
+      actual = std::to_string(result_.dropped());
+    } else if (what == "early") {
+      actual = std::to_string(result_.shown_early());
+    } else if (what == "disconnects") {
+      actual = std::to_string(result_.disconnects);
+    } else if (what == "close_frames") {
+      actual = std::to_string(result_.close_frames);
+    } else if (what == "errors") {
+      actual = std::to_string(result_.errors());
+    } else if (what == "reboots") {
+      actual = std::to_string(result_.reboots());
+    } else if (what == "heartbeats") {
+      actual = std::to_string(result_.heartbeats);
+    } else if (what == "parse_errors") {
+      actual = std::to_string(result_.parse_errors);
+    } else if (what == "last_event") {
+      for (auto it = result_.messages.rbegin(); it != result_.messages.rend(); ++it) {
+        if (it->delivered()) {
+          actual = it->event;
+          break;
+        }
+      }
+    } else {
+      fail_(line_number, "unknown expectation '" + what + "'");
+      return;
+    }
+    if (actual != expected) {
+      fail_(line_number, "expected " + what + " " + expected + ", got " + actual);
+    }
+  } else {
+    fail_(line_number, "unknown command '" + command + "'");
+  }
+}
+
+}  // namespace
+
+ReplayResult replay_script(const std::string &script, const std::string &base_dir) {
+  ReplayResult result;
+  Replay replay(base_dir, result);
+  std::istringstream lines(script);
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(lines, line)) {
+    replay.run_line(line, ++line_number);
+  }
+  return result;
+}
+
+ReplayResult replay_session_file(const std::string &path) {
+  std::string script;
+  if (!read_file(path, script)) {
+    ReplayResult result;
+    result.failures.push_back("can't read session " + path);
+    return result;
+  }
+  size_t slash = path.find_last_of('/');
+  return replay_script(script, slash == std::string::npos ? "." : path.substr(0, slash));
+}
+
+double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+void print_report(const ReplayResult &result, FILE *out) {
+  std::vector<double> to_delivered, to_visible;
+  for (const MessageTrace &m : result.messages) {
+    if (!m.delivered()) {
+      std::fprintf(out, "  dropped     %7zu wire bytes\n", m.wire_bytes);
+      continue;
+    }
+    double delivered = m.delivered_ms - m.first_chunk_ms;
+    std::fprintf(out, "  %-12s %7zu bytes (%7zu on the wire)  complete %8.1f ms", m.event.c_str(), m.message_bytes,
+                 m.wire_bytes, delivered);
+    if (m.visible_ms >= 0) {
+      double visible = m.visible_ms - m.first_chunk_ms;
+      std::fprintf(out, "  trips visible %8.1f ms", visible);
+      to_visible.push_back(visible);
+    }
+    std::fprintf(out, "\n");
+    if (m.event == "schedule") {
+      to_delivered.push_back(delivered);
+    }
+  }
+
+  std::fprintf(out,
+               "  %zu delivered, %zu dropped, %zu shown early, %zu heartbeats, %zu parse errors, %zu disconnects, "
+               "%zu close frames\n",
+               result.delivered(), result.dropped(), result.shown_early(), result.heartbeats, result.parse_errors,
+               result.disconnects, result.close_frames);
+  if (!to_delivered.empty()) {
+    std::fprintf(out, "  schedule complete: p50 %.1f ms, p90 %.1f ms, max %.1f ms\n", percentile(to_delivered, 0.5),
+                 percentile(to_delivered, 0.9), percentile(to_delivered, 1.0));
+  }
+  if (!to_visible.empty()) {
+    std::fprintf(out, "  trips visible:     p50 %.1f ms, p90 %.1f ms, max %.1f ms\n", percentile(to_visible, 0.5),
+                 percentile(to_visible, 0.9), percentile(to_visible, 1.0));
+  }
+  for (const OutageTrace &o : result.outages) {
+    std::fprintf(out, "  outage %8.0f ms: %d attempts, ", o.duration_ms, o.attempts);
+    if (o.reboot_ms >= 0) {
+      std::fprintf(out, "rebooted at %.0f ms", o.reboot_ms);
+    } else {
+      std::fprintf(out, "reconnected at %.0f ms", o.reconnected_ms);
+    }
+    if (o.error_ms >= 0) {
+      std::fprintf(out, ", error shown at %.0f ms", o.error_ms);
+    }
+    std::fprintf(out, "\n");
+  }
+  for (const std::string &failure : result.failures) {
+    std::fprintf(out, "  FAILED %s\n", failure.c_str());
+  }
+}
+
+}  // namespace transit_tracker_test
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace transit_tracker_test {
+
+/// What the client side saw of one message during a replay. Times are virtual
+/// milliseconds since the start of the session.
+struct MessageTrace {
+  std::string event;
+  size_t message_bytes = 0;
+  size_t wire_bytes = 0;
+  double first_chunk_ms = 0;
+  double visible_ms = -1;    // when its trips were first published to ScheduleState; -1 if never
+  double delivered_ms = -1;  // -1 if the message was dropped
+
+  bool delivered() const { return delivered_ms >= 0; }
+  bool shown_early() const { return visible_ms >= 0 && visible_ms < delivered_ms; }
+};
+
+/// How the client rode out one `outage`. Times are from the moment the connection dropped.
+struct OutageTrace {
+  double duration_ms = 0;
+  int attempts = 0;            // failed connection attempts
+  double reconnected_ms = -1;  // -1 if it rebooted first
+  double error_ms = -1;        // when the error status was raised; -1 if never
+  double reboot_ms = -1;       // when it rebooted; -1 if never
+};
+
+struct ReplayResult {
+  std::vector<MessageTrace> messages;
+  size_t heartbeats = 0;
+  size_t parse_errors = 0;  // complete messages the schedule feed couldn't parse
+  size_t disconnects = 0;
+  size_t close_frames = 0;
+  std::vector<OutageTrace> outages;
+  std::vector<std::string> failures;  // unmet `expect` lines and script errors
+
+  size_t delivered() const;
+  size_t dropped() const;
+  size_t shown_early() const;
+  size_t errors() const;
+  size_t reboots() const;
+};
+
+/// Replays a session script against the client-side pipeline on a virtual clock, so a
+/// session that takes minutes on a slow link runs instantly: MessageAssembler and the
+/// optional inflater, ScheduleFeed routing and parsing into a ScheduleState, and the
+/// ConnectionMonitor that decides when an outage warrants an error or a reboot.
+///
+/// Script lines (`#` starts a comment, `@file` payloads are relative to `base_dir`):
+///   buffer <bytes>          client receive buffer; longer frames arrive in chunks
+///   link <bytes/s>          link speed used to time chunk arrival (0 = instant)
+///   deflate on|off          server compresses messages (permessage-deflate)
+///   limit <n>               rows the client wants before rendering early
+///   wait <ms>               advance the clock
+///   send [opts] <payload>   one message; opts: fragments=N pings=1 truncate=BYTES garble=OFFSET
+///   ping                    a ping control frame
+///   close <code> [reason]   a close frame from the server
+///   disconnect | connect    the connection drops / comes back
+///   outage <ms> [fail_ms]   the server is unreachable for <ms>; each attempt fails after
+///                           fail_ms (default 0, refused). The client backs off per
+///                           ReconnectBackoff while ConnectionMonitor is checked every loop
+///   expect <what> <value>   delivered, dropped, early, heartbeats, parse_errors, disconnects,
+///                           close_frames, errors, reboots: counts; last_event: event name of
+///                           the last delivered message
+ReplayResult replay_script(const std::string &script, const std::string &base_dir);
+ReplayResult replay_session_file(const std::string &path);
+
+/// Prints one line per message plus latency percentiles.
+void print_report(const ReplayResult &result, FILE *out);
+
+/// Reads a whole file; false if it can't be opened.
+bool read_file(const std::string &path, std::string &out);
+/// The value below which a fraction `p` of `values` falls; 0 for none.
+double percentile(std::vector<double> values, double p);
+
+}  // namespace transit_tracker_test
@@ -0,0 +1,59 @@
+#include "zlib_codec.h"
+
+#include <cstring>
+
+namespace transit_tracker_test {
+
+static const char DEFLATE_TRAILER[] = {0x00, 0x00, static_cast<char>(0xff), static_cast<char>(0xff)};
+
+std::string deflate_message(const std::string &payload) {
+  z_stream stream{};
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+  std::string out(deflateBound(&stream, payload.size()) + 16, '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(payload.data()));
+  stream.avail_in = payload.size();
+  stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+  stream.avail_out = out.size();
+  deflate(&stream, Z_SYNC_FLUSH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  if (out.size() >= sizeof(DEFLATE_TRAILER) &&
+      std::memcmp(out.data() + out.size() - sizeof(DEFLATE_TRAILER), DEFLATE_TRAILER, sizeof(DEFLATE_TRAILER)) == 0) {
+    out.resize(out.size() - sizeof(DEFLATE_TRAILER));
+  }
+  return out;
+}
+
+ZlibInflater::ZlibInflater() { inflateInit2(&stream_, -15); }
+
+ZlibInflater::~ZlibInflater() { inflateEnd(&stream_); }
+
+void ZlibInflater::reset() { inflateReset(&stream_); }
+
+bool ZlibInflater::inflate(const uint8_t *data, size_t len, esphome::transit_tracker::MessageAssembler &out) {
+  char buffer[1024];
+  stream_.next_in = const_cast<Bytef *>(data);
+  stream_.avail_in = len;
+
+  while (true) {
+    stream_.next_out = reinterpret_cast<Bytef *>(buffer);
+    stream_.avail_out = sizeof(buffer);
+    int ret = ::inflate(&stream_, Z_SYNC_FLUSH);
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+      return false;
+    }
+
+    size_t produced = sizeof(buffer) - stream_.avail_out;
+    if (produced > 0 && !out.append(buffer, produced)) {
+      return false;
+    }
+
+    if (ret == Z_STREAM_END || (stream_.avail_in == 0 && stream_.avail_out != 0) || ret == Z_BUF_ERROR) {
+      return true;
+    }
+  }
+}
+
+}  // namespace transit_tracker_test
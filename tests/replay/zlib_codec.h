@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include <zlib.h>
+
+#include "message_assembler.h"
+
+namespace transit_tracker_test {
+
+/// Compresses one message the way a permessage-deflate server with
+/// server_no_context_takeover does: a raw DEFLATE stream, sync-flushed,
+/// with the trailing 00 00 ff ff removed.
+std::string deflate_message(const std::string &payload);
+
+/// Host replacement for the device's ROM tinfl inflater.
+class ZlibInflater : public esphome::transit_tracker::Inflater {
+ public:
+  ZlibInflater();
+  ~ZlibInflater() override;
+
+  ZlibInflater(const ZlibInflater &) = delete;
+  ZlibInflater &operator=(const ZlibInflater &) = delete;
+
+  void reset() override;
+  bool inflate(const uint8_t *data, size_t len, esphome::transit_tracker::MessageAssembler &out) override;
+
+ protected:
+  z_stream stream_{};
+};
+
+}  // namespace transit_tracker_test
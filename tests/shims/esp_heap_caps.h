@@ -0,0 +1,31 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's capability-aware heap. Everything comes from malloc;
+// tests can cap the largest free block to simulate a fragmented or exhausted heap,
+// and read how much is allocated through it.
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps);
+void *heap_caps_malloc_prefer(size_t size, size_t num, ...);
+void *heap_caps_realloc_prefer(void *ptr, size_t size, size_t num, ...);
+void heap_caps_free(void *ptr);
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_total_size(uint32_t caps);
+
+/// Allocations larger than `bytes` fail, as if that were the largest free block. 0 removes the cap.
+void host_heap_set_largest_free_block(size_t bytes);
+
+/// Bytes currently allocated through heap_caps_*, and the most since the last reset.
+size_t host_heap_get_allocated();
+size_t host_heap_get_peak_allocated();
+void host_heap_reset_peak();
@@ -0,0 +1,97 @@
+#pragma once
+
+// Host stand-in for ESPHome's display component: an in-memory framebuffer with the
+// drawing calls the renderer makes. Text is placed as Display::get_text_bounds() places
+// it and clipped as DisplayBuffer clips, so the host draws the same pixels the device
+// would for a font with the same metrics.
+
+#include <cstddef>
+#include <vector>
+
+#include "esphome/core/color.h"
+
+namespace esphome {
+namespace display {
+
+enum class TextAlign {
+  TOP = 0x00,
+  CENTER_VERTICAL = 0x01,
+  BASELINE = 0x02,
+  BOTTOM = 0x04,
+
+  LEFT = 0x00,
+  CENTER_HORIZONTAL = 0x08,
+  RIGHT = 0x10,
+
+  TOP_LEFT = TOP | LEFT,
+  TOP_CENTER = TOP | CENTER_HORIZONTAL,
+  TOP_RIGHT = TOP | RIGHT,
+
+  CENTER_LEFT = CENTER_VERTICAL | LEFT,
+  CENTER = CENTER_VERTICAL | CENTER_HORIZONTAL,
+  CENTER_RIGHT = CENTER_VERTICAL | RIGHT,
+
+  BASELINE_LEFT = BASELINE | LEFT,
+  BASELINE_CENTER = BASELINE | CENTER_HORIZONTAL,
+  BASELINE_RIGHT = BASELINE | RIGHT,
+
+  BOTTOM_LEFT = BOTTOM | LEFT,
+  BOTTOM_CENTER = BOTTOM | CENTER_HORIZONTAL,
+  BOTTOM_RIGHT = BOTTOM | RIGHT,
+};
+
+class Display;
+
+class BaseFont {
+ public:
+  virtual ~BaseFont() = default;
+  virtual void print(int x, int y, Display *display, Color color, const char *text) = 0;
+  virtual void measure(const char *str, int *width, int *x_offset, int *baseline, int *height) = 0;
+};
+
+class Display {
+ public:
+  Display(int width, int height) : width_(width), height_(height), framebuffer_(width * height) {}
+
+  int get_width() const { return width_; }
+  int get_height() const { return height_; }
+
+  void draw_pixel_at(int x, int y, Color color);
+  void print(int x, int y, BaseFont *font, Color color, TextAlign align, const char *text);
+  void print(int x, int y, BaseFont *font, const char *text) {
+    print(x, y, font, COLOR_ON, TextAlign::TOP_LEFT, text);
+  }
+
+  /// Pixels outside [left, right) x [top, bottom) are dropped until end_clipping(). Nested
+  /// regions are intersected with the enclosing one.
+  void start_clipping(int left, int top, int right, int bottom);
+  void end_clipping();
+
+  // Host only
+
+  /// Blanks the framebuffer and zeroes the counters, as the start of a frame.
+  void clear();
+  Color get_pixel(int x, int y) const { return framebuffer_[y * width_ + x]; }
+  /// Pixels written since clear(), clipped ones excluded. Overdrawn pixels count every time.
+  size_t get_pixels_drawn() const { return pixels_drawn_; }
+  /// print() calls since clear().
+  size_t get_text_draws() const { return text_draws_; }
+
+ protected:
+  struct Rect {
+    int left;
+    int top;
+    int right;
+    int bottom;
+  };
+
+  int width_;
+  int height_;
+  std::vector<Color> framebuffer_;
+  std::vector<Rect> clipping_;
+  size_t pixels_drawn_{0};
+  size_t text_draws_{0};
+};
+
+}  // namespace display
+}  // namespace esphome
@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for ESPHome's font component. It has real metrics but no glyph data:
+// each character is a bitmap derived from its code, so frames differ wherever the text,
+// its position or its clipping does, without shipping a font file.
+
+#include "esphome/components/display/display.h"
+
+namespace esphome {
+namespace font {
+
+class Font : public display::BaseFont {
+ public:
+  Font(int ascender, int descender) : ascender_(ascender), descender_(descender) {}
+
+  void print(int x, int y, display::Display *display, Color color, const char *text) override;
+  void measure(const char *str, int *width, int *x_offset, int *baseline, int *height) override;
+
+  int get_ascender() const { return ascender_; }
+  int get_descender() const { return descender_; }
+  int get_baseline() const { return ascender_; }
+  int get_height() const { return ascender_ + descender_; }
+
+ protected:
+  int ascender_;
+  int descender_;
+};
+
+}  // namespace font
+}  // namespace esphome
@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in for the ESPHome JSON component. When CMake found ArduinoJson this is
+// the real library, as on the device; otherwise only the allocator interface that
+// memory.h implements, for targets that never parse JSON.
+
+#if __has_include(<ArduinoJson.h>)
+
+#include <ArduinoJson.h>
+
+#else
+
+#include <cstddef>
+
+namespace ArduinoJson {
+
+class Allocator {
+ public:
+  virtual void *allocate(size_t size) = 0;
+  virtual void deallocate(void *ptr) = 0;
+  virtual void *reallocate(void *ptr, size_t new_size) = 0;
+
+ protected:
+  ~Allocator() = default;
+};
+
+}  // namespace ArduinoJson
+
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for the ESPHome time component. Host-built sources take the time
+// as an argument, so only the types it pulls in are needed.
+
+#include <ctime>
+#include <sys/types.h>
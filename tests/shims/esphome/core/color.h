@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in for esphome::Color with the constructors the component uses.
+
+#include <cstdint>
+
+namespace esphome {
+
+struct Color {
+  uint8_t r{0};
+  uint8_t g{0};
+  uint8_t b{0};
+  uint8_t w{0};
+
+  Color() = default;
+  Color(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+  Color(uint8_t red, uint8_t green, uint8_t blue, uint8_t white) : r(red), g(green), b(blue), w(white) {}
+  explicit Color(uint32_t rgb) : r((rgb >> 16) & 0xFF), g((rgb >> 8) & 0xFF), b(rgb & 0xFF) {}
+
+  bool operator==(const Color &other) const { return r == other.r && g == other.g && b == other.b && w == other.w; }
+};
+
+static const Color COLOR_OFF(0, 0, 0, 0);
+static const Color COLOR_ON(255, 255, 255, 255);
+
+}  // namespace esphome
@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand-in for the defines.h ESPHome generates from the YAML config. Nothing
+// optional is enabled on the host, so the frame profiler compiles out.
@@ -0,0 +1,17 @@
+#pragma once
+
+// Host stand-in for ESPHome's HAL clock. millis() reads a virtual clock that tests
+// and the replay harness advance explicitly, so timing-dependent code runs instantly.
+
+#include <cstdint>
+
+#define HOT __attribute__((hot))
+
+namespace esphome {
+
+uint32_t millis();
+
+/// Sets what millis() returns.
+void host_set_millis(uint32_t ms);
+
+}  // namespace esphome
@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for the ESPHome helpers the host-built sources use.
+
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+namespace esphome {
+
+inline std::string __attribute__((format(printf, 1, 2))) str_sprintf(const char *fmt, ...) {
+  std::string str;
+  va_list args;
+
+  va_start(args, fmt);
+  int length = vsnprintf(nullptr, 0, fmt, args);
+  va_end(args);
+
+  if (length > 0) {
+    str.resize(length);
+    va_start(args, fmt);
+    vsnprintf(&str[0], length + 1, fmt, args);
+    va_end(args);
+  }
+  return str;
+}
+
+}  // namespace esphome
@@ -0,0 +1,20 @@
+#pragma once
+
+// Host stand-in for ESPHome logging. Messages are type-checked but discarded unless
+// TT_HOST_LOG is set in the environment.
+
+#include <cstdio>
+#include <cstdlib>
+
+#define TT_HOST_LOG_(level, tag, fmt, ...) \
+  do { \
+    if (std::getenv("TT_HOST_LOG") != nullptr) { \
+      std::fprintf(stderr, "[" level "][%s] " fmt "\n", tag, ##__VA_ARGS__); \
+    } \
+  } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) TT_HOST_LOG_("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) TT_HOST_LOG_("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) TT_HOST_LOG_("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) TT_HOST_LOG_("D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) TT_HOST_LOG_("V", tag, fmt, ##__VA_ARGS__)
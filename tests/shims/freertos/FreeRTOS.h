@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS types that appear in component headers.
+// Nothing on the host creates tasks, so only the declarations are needed.
@@ -0,0 +1,11 @@
+#include "esphome/core/hal.h"
+
+namespace esphome {
+
+static uint32_t now_ms = 0;
+
+uint32_t millis() { return now_ms; }
+
+void host_set_millis(uint32_t ms) { now_ms = ms; }
+
+}  // namespace esphome
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+#include "esphome/components/display/display.h"
+#include "esphome/components/font/font.h"
+
+namespace esphome {
+namespace display {
+
+void Display::draw_pixel_at(int x, int y, Color color) {
+  if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+    return;
+  }
+  if (!clipping_.empty()) {
+    const Rect &clip = clipping_.back();
+    if (x < clip.left || y < clip.top || x >= clip.right || y >= clip.bottom) {
+      return;
+    }
+  }
+  framebuffer_[y * width_ + x] = color;
+  pixels_drawn_++;
+}
+
+void Display::print(int x, int y, BaseFont *font, Color color, TextAlign align, const char *text) {
+  int width, x_offset, baseline, height;
+  font->measure(text, &width, &x_offset, &baseline, &height);
+
+  int x_align = static_cast<int>(align) & 0x18;
+  int y_align = static_cast<int>(align) & 0x07;
+  int x1 = x;
+  if (x_align == static_cast<int>(TextAlign::RIGHT)) {
+    x1 = x - width;
+  } else if (x_align == static_cast<int>(TextAlign::CENTER_HORIZONTAL)) {
+    x1 = x - width / 2;
+  }
+  int y1 = y;
+  if (y_align == static_cast<int>(TextAlign::BOTTOM)) {
+    y1 = y - height;
+  } else if (y_align == static_cast<int>(TextAlign::BASELINE)) {
+    y1 = y - baseline;
+  } else if (y_align == static_cast<int>(TextAlign::CENTER_VERTICAL)) {
+    y1 = y - height / 2;
+  }
+
+  text_draws_++;
+  font->print(x1, y1, this, color, text);
+}
+
+void Display::start_clipping(int left, int top, int right, int bottom) {
+  Rect clip{left, top, right, bottom};
+  if (!clipping_.empty()) {
+    const Rect &outer = clipping_.back();
+    clip = {std::max(left, outer.left), std::max(top, outer.top), std::min(right, outer.right),
+            std::min(bottom, outer.bottom)};
+  }
+  clipping_.push_back(clip);
+}
+
+void Display::end_clipping() {
+  if (!clipping_.empty()) {
+    clipping_.pop_back();
+  }
+}
+
+void Display::clear() {
+  std::fill(framebuffer_.begin(), framebuffer_.end(), COLOR_OFF);
+  clipping_.clear();
+  pixels_drawn_ = 0;
+  text_draws_ = 0;
+}
+
+}  // namespace display
+
+namespace font {
+
+static constexpr int SPACE_ADVANCE = 3;
+
+static int glyph_width(unsigned char c) { return c == ' ' ? 0 : 3 + c % 3; }
+
+static int glyph_advance(unsigned char c) { return c == ' ' ? SPACE_ADVANCE : glyph_width(c) + 1; }
+
+void Font::print(int x, int y, display::Display *display, Color color, const char *text) {
+  for (const char *p = text; *p != '\0'; p++) {
+    unsigned char c = *p;
+    int width = glyph_width(c);
+    // Lowercase sits at x-height and a few letters reach into the descender
+    int top = std::islower(c) ? ascender_ / 3 : 1;
+    int bottom = std::strchr("gjpqy", c) != nullptr ? ascender_ + descender_ : ascender_;
+    uint32_t bits = c * 0x9E3779B1u;
+
+    for (int gy = top; gy < bottom; gy++) {
+      for (int gx = 0; gx < width; gx++) {
+        if (gx == 0 || gy == top || ((bits >> ((gx * 7 + gy * 3) & 31)) & 1)) {
+          display->draw_pixel_at(x + gx, y + gy, color);
+        }
+      }
+    }
+    x += glyph_advance(c);
+  }
+}
+
+void Font::measure(const char *str, int *width, int *x_offset, int *baseline, int *height) {
+  *width = 0;
+  for (const char *p = str; *p != '\0'; p++) {
+    *width += glyph_advance(static_cast<unsigned char>(*p));
+  }
+  *x_offset = 0;
+  *baseline = ascender_;
+  *height = ascender_ + descender_;
+}
+
+}  // namespace font
+}  // namespace esphome
@@ -0,0 +1,61 @@
+#include "esp_heap_caps.h"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+static size_t largest_free_block = 0;
+static size_t allocated = 0;
+static size_t peak_allocated = 0;
+
+void host_heap_set_largest_free_block(size_t bytes) { largest_free_block = bytes; }
+
+size_t host_heap_get_allocated() { return allocated; }
+size_t host_heap_get_peak_allocated() { return peak_allocated; }
+void host_heap_reset_peak() { peak_allocated = allocated; }
+
+static bool fits(size_t size) { return largest_free_block == 0 || size <= largest_free_block; }
+
+// Counted by usable size, which is what the allocation actually holds on to
+static void *track(void *ptr) {
+  if (ptr != nullptr) {
+    allocated += malloc_usable_size(ptr);
+    peak_allocated = std::max(peak_allocated, allocated);
+  }
+  return ptr;
+}
+
+static void untrack(void *ptr) {
+  if (ptr != nullptr) {
+    allocated -= malloc_usable_size(ptr);
+  }
+}
+
+static void *tracked_realloc(void *ptr, size_t size) {
+  if (!fits(size)) {
+    return nullptr;
+  }
+  size_t old_size = ptr != nullptr ? malloc_usable_size(ptr) : 0;
+  void *result = realloc(ptr, size);
+  if (result == nullptr) {
+    return nullptr;  // the old block is untouched
+  }
+  allocated -= old_size;
+  return track(result);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t) { return fits(size) ? track(malloc(size)) : nullptr; }
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t) { return tracked_realloc(ptr, size); }
+void *heap_caps_malloc_prefer(size_t size, size_t, ...) { return fits(size) ? track(malloc(size)) : nullptr; }
+void *heap_caps_realloc_prefer(void *ptr, size_t size, size_t, ...) { return tracked_realloc(ptr, size); }
+void heap_caps_free(void *ptr) {
+  untrack(ptr);
+  free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t) { return largest_free_block != 0 ? largest_free_block : SIZE_MAX; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return heap_caps_get_free_size(caps); }
+size_t heap_caps_get_largest_free_block(uint32_t) { return largest_free_block != 0 ? largest_free_block : SIZE_MAX; }
+// No PSRAM on the host
+size_t heap_caps_get_total_size(uint32_t caps) { return (caps & MALLOC_CAP_SPIRAM) ? 0 : SIZE_MAX; }
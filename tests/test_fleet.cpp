@@ -0,0 +1,79 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "fleet_sim.h"
+#include "session_replay.h"
+
+using namespace transit_tracker_test;
+
+static FleetConfig small_fleet() {
+  FleetConfig config;
+  config.clients = 100;
+  config.duration_ms = 120000;
+  config.restart_at_ms = 30000;
+  config.restart_ms = 10000;
+  EXPECT_TRUE(read_file(std::string(TT_DATA_DIR) + "/schedule_small.json", config.schedule));
+  return config;
+}
+
+TEST(Fleet, EverySignResubscribesAfterARestart) {
+  FleetConfig config = small_fleet();
+  auto result = run_fleet(config);
+
+  // once at boot and once after the restart
+  EXPECT_GE(result.subscribe_ms.size(), 2 * config.clients);
+  EXPECT_GE(result.recovered_ms, 0);
+  EXPECT_EQ(result.parse_errors, 0u);
+  EXPECT_EQ(result.reboots, 0u);
+  EXPECT_GT(result.heartbeats, 0u);
+  // every subscribe is answered after the server's own work, at the earliest
+  EXPECT_GE(percentile(result.subscribe_ms, 0), config.subscribe_cost_ms);
+}
+
+TEST(Fleet, JitterSpreadsTheReconnectStorm) {
+  FleetConfig config = small_fleet();
+  config.clients = 400;
+  config.boot_spread_ms = 60000;  // so the storm after the restart is the peak
+  config.restart_at_ms = 70000;
+  auto result = run_fleet(config);
+
+  // every sign dropped at once, but the first retries spread over half the base delay
+  EXPECT_LT(result.peak_attempts_per_s(config.restart_at_ms), config.clients / 2);
+  EXPECT_LT(result.peak_attempts_per_s(0), config.clients / 2);
+}
+
+TEST(Fleet, AnOverloadedServerTimesAttemptsOutWithoutRebooting) {
+  FleetConfig config = small_fleet();
+  config.clients = 300;
+  config.duration_ms = 300000;
+  config.handshake_cost_ms = 40;  // 300 handshakes take 12 s, longer than the network timeout
+  auto result = run_fleet(config);
+
+  EXPECT_GT(result.failed_attempts, 0u);
+  EXPECT_GE(result.recovered_ms, 0);
+  EXPECT_EQ(result.reboots, 0u);
+}
+
+TEST(Fleet, ALongOutageRebootsTheFleet) {
+  FleetConfig config = small_fleet();
+  config.duration_ms = 400000;
+  config.restart_ms = 200000;
+  auto result = run_fleet(config);
+
+  // the error shows again while the rebooted signs wait for the server
+  EXPECT_GE(result.errors, config.clients);
+  EXPECT_EQ(result.reboots, config.clients);
+  EXPECT_GE(result.recovered_ms, 0);
+}
+
+TEST(Fleet, MeasuresMemoryPerSign) {
+  FleetConfig config = small_fleet();
+  config.restart_at_ms = -1;
+  auto result = run_fleet(config);
+
+  EXPECT_LT(result.recovered_ms, 0);  // nothing to recover from
+  EXPECT_GT(result.retained_bytes_per_client, 0u);
+  // at least the message itself is buffered while it is handled
+  EXPECT_GE(result.peak_message_bytes, config.schedule.size());
+}
@@ -0,0 +1,115 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "json_scan.h"
+
+using esphome::transit_tracker::find_leading_trips;
+using esphome::transit_tracker::LeadingTripScanner;
+using esphome::transit_tracker::peek_event;
+using esphome::transit_tracker::TripScan;
+
+static std::string_view peek(const std::string &json) { return peek_event(json.data(), json.size()); }
+
+TEST(PeekEvent, FindsTopLevelEvent) {
+  EXPECT_EQ(peek(R"({"event":"heartbeat","data":null})"), "heartbeat");
+  EXPECT_EQ(peek(R"({ "data" : {"event":"nested"}, "event" : "schedule" })"), "schedule");
+}
+
+TEST(PeekEvent, IgnoresLookalikes) {
+  EXPECT_EQ(peek(R"({"data":{"event":"nested"}})"), "");
+  EXPECT_EQ(peek(R"({"note":"event","x":1})"), "");
+  EXPECT_EQ(peek(R"({"event":"esc\"aped"})"), "");
+  EXPECT_EQ(peek(R"({"event":42})"), "");
+}
+
+TEST(PeekEvent, HandlesTruncatedInput) {
+  EXPECT_EQ(peek(R"({"event":"sched)"), "");
+  EXPECT_EQ(peek(R"({"eve)"), "");
+  EXPECT_EQ(peek(""), "");
+}
+
+static TripScan scan(const std::string &json, size_t count, std::string *slice = nullptr) {
+  size_t start = 0, end = 0;
+  TripScan result = find_leading_trips(json.data(), json.size(), count, start, end);
+  if (result == TripScan::FOUND && slice != nullptr) {
+    *slice = json.substr(start, end - start);
+  }
+  return result;
+}
+
+TEST(FindLeadingTrips, FindsFirstObjects) {
+  std::string json = R"({"event":"schedule","data":{"trips":[{"a":1},{"b":"}{"},{"c":[3]}]}})";
+  std::string slice;
+  EXPECT_EQ(scan(json, 2, &slice), TripScan::FOUND);
+  EXPECT_EQ(slice, R"([{"a":1},{"b":"}{"})");
+}
+
+TEST(FindLeadingTrips, WaitsForMoreData) {
+  EXPECT_EQ(scan(R"({"event":"schedule","data":{"trips":[{"a":1},{"b":)", 2), TripScan::PENDING);
+  EXPECT_EQ(scan(R"({"event":"schedule","data":{"tri)", 1), TripScan::PENDING);
+}
+
+TEST(FindLeadingTrips, ReportsShortLists) {
+  EXPECT_EQ(scan(R"({"data":{"trips":[{"a":1}]}})", 3), TripScan::CLOSED);
+  EXPECT_EQ(scan(R"({"data":{"trips":[]}})", 1), TripScan::CLOSED);
+}
+
+TEST(FindLeadingTrips, IgnoresUnbalancedInputBeforeTheArray) {
+  // a stray quote hides the "trips" key, and the closing braces drive the depth negative
+  EXPECT_EQ(scan(R"({"data":{"events":"x"","trips":[{"a":1}]}}})", 1), TripScan::PENDING);
+}
+
+TEST(LeadingTripScanner, ResumesAcrossFragments) {
+  const std::string json = R"({"event":"schedule","data":{"trips":[{"a":"x\"}"},{"b":[1,{"c":2}]},{"d":3}]}})";
+  // every split point, including inside keys, strings and escapes
+  for (size_t split = 0; split <= json.size(); split++) {
+    LeadingTripScanner scanner;
+    scanner.reset(2);
+    scanner.scan(json.data(), split);
+    scanner.scan(json.data(), json.size());
+    ASSERT_TRUE(scanner.has_event()) << split;
+    EXPECT_EQ(scanner.event(json.data()), "schedule") << split;
+    ASSERT_EQ(scanner.trips(), TripScan::FOUND) << split;
+    EXPECT_EQ(json.substr(scanner.array_start(), scanner.array_end() - scanner.array_start()),
+              R"([{"a":"x\"}"},{"b":[1,{"c":2}]})")
+        << split;
+  }
+}
+
+TEST(LeadingTripScanner, ReportsOtherEventsEarly) {
+  const std::string json = R"({"event":"heartbeat","data":{"trips":[{"a":1}]}})";
+  LeadingTripScanner scanner;
+  scanner.reset(1);
+  scanner.scan(json.data(), 21);
+  ASSERT_TRUE(scanner.has_event());
+  EXPECT_EQ(scanner.event(json.data()), "heartbeat");
+  EXPECT_EQ(scanner.trips(), TripScan::PENDING);
+}
+
+TEST(LeadingTripScanner, HandlesOneByteFragments) {
+  // a schedule arriving one byte at a time
+  std::string json = R"({"event":"schedule","data":{"trips":[)";
+  for (int i = 0; i < 200; i++) {
+    json += R"({"tripId":"t)" + std::to_string(i) + R"(","headsign":"Downtown"},)";
+  }
+  LeadingTripScanner scanner;
+  scanner.reset(150);
+  for (size_t len = 1; len <= json.size() && scanner.trips() == TripScan::PENDING; len++) {
+    scanner.scan(json.data(), len);
+  }
+  EXPECT_EQ(scanner.trips(), TripScan::FOUND);
+  EXPECT_EQ(json[scanner.array_end() - 1], '}');
+}
+
+TEST(LeadingTripScanner, ResetStartsANewMessage) {
+  const std::string first = R"({"event":"heartbeat"})";
+  const std::string second = R"({"event":"schedule","data":{"trips":[]}})";
+  LeadingTripScanner scanner;
+  scanner.reset(1);
+  scanner.scan(first.data(), first.size());
+  scanner.reset(1);
+  scanner.scan(second.data(), second.size());
+  EXPECT_EQ(scanner.event(second.data()), "schedule");
+  EXPECT_EQ(scanner.trips(), TripScan::CLOSED);
+}
@@ -0,0 +1,80 @@
+#include <climits>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "localization.h"
+
+using esphome::transit_tracker::Localization;
+using esphome::transit_tracker::UnitDisplay;
+
+static constexpr time_t TRIP_TIME = 1700000000;
+
+class NextChangeTest : public testing::TestWithParam<UnitDisplay> {
+ protected:
+  void SetUp() override { localization_.set_unit_display(GetParam()); }
+
+  std::string text(uint rtc_now) const { return localization_.fmt_duration_from_now(TRIP_TIME, rtc_now); }
+
+  Localization localization_;
+};
+
+TEST_P(NextChangeTest, MatchesTheFormattedText) {
+  for (int diff : {29, 30, 59, 60, 119, 3600}) {
+    SCOPED_TRACE("diff=" + std::to_string(diff));
+    const uint now = TRIP_TIME - diff;
+    const std::string shown = text(now);
+    const uint change = localization_.next_change(TRIP_TIME, now);
+
+    if (diff < 30) {
+      EXPECT_EQ(change, UINT_MAX);
+      // "Now" holds until the trip expires
+      for (uint t = now; t < TRIP_TIME + 120; t++) {
+        EXPECT_EQ(text(t), shown);
+      }
+      continue;
+    }
+
+    ASSERT_GT(change, now);
+    for (uint t = now; t < change; t++) {
+      EXPECT_EQ(text(t), shown) << "at " << t - now << "s";
+    }
+    EXPECT_NE(text(change), shown);
+  }
+}
+
+TEST_P(NextChangeTest, FollowsEachFlipDownToNow) {
+  uint now = TRIP_TIME - 3600;
+  int flips = 0;
+  while (now != UINT_MAX) {
+    const uint change = localization_.next_change(TRIP_TIME, now);
+    if (change != UINT_MAX) {
+      EXPECT_EQ(text(change - 1), text(now));
+      EXPECT_NE(text(change), text(now));
+      flips++;
+    }
+    now = change;
+  }
+  // 60min..1min, 0min, then Now
+  EXPECT_EQ(flips, 61);
+}
+
+INSTANTIATE_TEST_SUITE_P(UnitDisplays, NextChangeTest,
+                         testing::Values(esphome::transit_tracker::UNIT_DISPLAY_LONG,
+                                         esphome::transit_tracker::UNIT_DISPLAY_SHORT,
+                                         esphome::transit_tracker::UNIT_DISPLAY_NONE));
+
+TEST(Localization, FormatsEachUnitDisplay) {
+  Localization localization;
+  EXPECT_EQ(localization.fmt_duration_from_now(TRIP_TIME, TRIP_TIME - 29), "Now");
+  EXPECT_EQ(localization.fmt_duration_from_now(TRIP_TIME, TRIP_TIME - 30), "0min");
+  EXPECT_EQ(localization.fmt_duration_from_now(TRIP_TIME, TRIP_TIME - 119), "1min");
+  EXPECT_EQ(localization.fmt_duration_from_now(TRIP_TIME, TRIP_TIME - 3600), "1h0m");
+
+  localization.set_unit_display(esphome::transit_tracker::UNIT_DISPLAY_SHORT);
+  EXPECT_EQ(localization.fmt_duration_from_now(TRIP_TIME, TRIP_TIME - 60), "1m");
+
+  localization.set_unit_display(esphome::transit_tracker::UNIT_DISPLAY_NONE);
+  EXPECT_EQ(localization.fmt_duration_from_now(TRIP_TIME, TRIP_TIME - 59), "0");
+  EXPECT_EQ(localization.fmt_duration_from_now(TRIP_TIME, TRIP_TIME - 3600), "1:00");
+}
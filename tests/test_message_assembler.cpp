@@ -0,0 +1,152 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "esp_heap_caps.h"
+#include "message_assembler.h"
+#include "zlib_codec.h"
+
+using esphome::transit_tracker::BulkString;
+using esphome::transit_tracker::FrameChunk;
+using esphome::transit_tracker::MessageAssembler;
+
+namespace {
+
+class MessageAssemblerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    assembler_.set_on_message([this](const BulkString &m) { messages_.emplace_back(m.data(), m.size()); });
+    assembler_.set_on_partial_message([this](const BulkString &) { partials_++; });
+    assembler_.set_on_message_start([this]() { starts_++; });
+  }
+
+  // Feeds `frame` as one websocket frame, delivered in chunks of `chunk_size` bytes
+  void feed_frame(uint8_t op, bool fin, const std::string &frame, size_t chunk_size = SIZE_MAX) {
+    size_t offset = 0;
+    do {
+      size_t len = std::min(chunk_size, frame.size() - offset);
+      assembler_.feed(FrameChunk{op, fin, static_cast<int>(frame.size()), static_cast<int>(offset),
+                                 frame.data() + offset, static_cast<int>(len)});
+      offset += len;
+    } while (offset < frame.size());
+  }
+
+  MessageAssembler assembler_;
+  std::vector<std::string> messages_;
+  int partials_ = 0;
+  int starts_ = 0;
+};
+
+TEST_F(MessageAssemblerTest, DeliversSingleFrame) {
+  feed_frame(0x01, true, R"({"event":"heartbeat"})");
+  ASSERT_EQ(messages_.size(), 1u);
+  EXPECT_EQ(messages_[0], R"({"event":"heartbeat"})");
+  EXPECT_EQ(partials_, 0);
+  EXPECT_FALSE(assembler_.is_receiving());
+}
+
+TEST_F(MessageAssemblerTest, JoinsChunksAndFragments) {
+  feed_frame(0x01, false, R"({"event":"sch)", 4);
+  feed_frame(0x09, true, "");  // a ping between fragments
+  EXPECT_TRUE(assembler_.is_receiving());
+  feed_frame(0x00, true, R"(edule"})", 3);
+  ASSERT_EQ(messages_.size(), 1u);
+  EXPECT_EQ(messages_[0], R"({"event":"schedule"})");
+  EXPECT_EQ(starts_, 1);
+  EXPECT_GT(partials_, 0);
+}
+
+TEST_F(MessageAssemblerTest, DropsOutOfOrderChunk) {
+  std::string frame = R"({"event":"schedule"})";
+  assembler_.feed(FrameChunk{0x01, true, static_cast<int>(frame.size()), 0, frame.data(), 5});
+  assembler_.feed(FrameChunk{0x01, true, static_cast<int>(frame.size()), 8, frame.data() + 8, 12});
+  EXPECT_TRUE(messages_.empty());
+
+  feed_frame(0x01, true, R"({"event":"heartbeat"})");
+  EXPECT_EQ(messages_.size(), 1u);
+}
+
+TEST_F(MessageAssemblerTest, DropsOrphanContinuation) {
+  feed_frame(0x00, true, R"(tail"})");
+  EXPECT_TRUE(messages_.empty());
+  EXPECT_EQ(starts_, 0);
+}
+
+TEST_F(MessageAssemblerTest, DropsMessagesOverTheLimit) {
+  assembler_.set_max_message_size(16);
+  feed_frame(0x01, true, std::string(32, 'x'));
+  feed_frame(0x01, false, std::string(10, 'x'));
+  feed_frame(0x00, true, std::string(10, 'x'));
+  EXPECT_TRUE(messages_.empty());
+
+  feed_frame(0x01, true, "{}");
+  EXPECT_EQ(messages_.size(), 1u);
+}
+
+TEST_F(MessageAssemblerTest, ResetAbandonsMessageInProgress) {
+  feed_frame(0x01, false, R"({"event":)");
+  assembler_.reset();
+  EXPECT_FALSE(assembler_.is_receiving());
+  feed_frame(0x00, true, R"("schedule"})");
+  EXPECT_TRUE(messages_.empty());
+}
+
+TEST_F(MessageAssemblerTest, IgnoresCloseFrames) {
+  feed_frame(0x08, true, std::string("\x03\xe9going away", 12));
+  EXPECT_TRUE(messages_.empty());
+  EXPECT_EQ(starts_, 0);
+}
+
+TEST_F(MessageAssemblerTest, InflatesCompressedMessages) {
+  transit_tracker_test::ZlibInflater inflater;
+  assembler_.set_inflater(&inflater);
+
+  std::string payload = R"({"event":"schedule","data":{"trips":[]}})";
+  std::string wire = transit_tracker_test::deflate_message(payload);
+  feed_frame(0x01, false, wire.substr(0, wire.size() / 2), 3);
+  feed_frame(0x00, true, wire.substr(wire.size() / 2), 3);
+
+  // uncompressed messages still pass through while compression is negotiated
+  feed_frame(0x01, true, R"({"event":"heartbeat"})");
+
+  ASSERT_EQ(messages_.size(), 2u);
+  EXPECT_EQ(messages_[0], payload);
+  EXPECT_EQ(messages_[1], R"({"event":"heartbeat"})");
+  EXPECT_EQ(assembler_.get_message_bytes(), payload.size() + messages_[1].size());
+}
+
+TEST_F(MessageAssemblerTest, LimitAppliesToInflatedSize) {
+  transit_tracker_test::ZlibInflater inflater;
+  assembler_.set_inflater(&inflater);
+  assembler_.set_max_message_size(1024);
+
+  // compresses to a few dozen bytes, inflates past the limit
+  std::string bomb = "{\"pad\":\"" + std::string(64 * 1024, 'a') + "\"}";
+  feed_frame(0x01, true, transit_tracker_test::deflate_message(bomb));
+  EXPECT_TRUE(messages_.empty());
+}
+
+TEST_F(MessageAssemblerTest, DropsMessagesTheHeapCantHold) {
+  // BulkAllocator aborts on failure, so the buffer must never ask for more than is free
+  host_heap_set_largest_free_block(256);
+  feed_frame(0x01, true, std::string(1024, 'x'));
+  feed_frame(0x01, false, std::string(200, 'x'), 50);
+  feed_frame(0x00, true, std::string(200, 'x'), 50);
+  host_heap_set_largest_free_block(0);
+  EXPECT_TRUE(messages_.empty());
+
+  feed_frame(0x01, true, std::string(1024, 'x'));
+  EXPECT_EQ(messages_.size(), 1u);
+}
+
+TEST_F(MessageAssemblerTest, InflatedMessagesRespectTheHeap) {
+  transit_tracker_test::ZlibInflater inflater;
+  assembler_.set_inflater(&inflater);
+  host_heap_set_largest_free_block(4096);
+  feed_frame(0x01, true, transit_tracker_test::deflate_message("{\"pad\":\"" + std::string(16 * 1024, 'a') + "\"}"));
+  host_heap_set_largest_free_block(0);
+  EXPECT_TRUE(messages_.empty());
+}
+
+}  // namespace
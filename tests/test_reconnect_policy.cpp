@@ -0,0 +1,125 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "esphome/core/hal.h"
+
+#include "reconnect_policy.h"
+
+using namespace esphome::transit_tracker;
+
+TEST(ReconnectBackoff, DoublesUpToTheCapWithJitter) {
+  ReconnectBackoff backoff;
+  backoff.set_base_delay_ms(5000);
+  backoff.set_max_delay_ms(30000);
+
+  const uint32_t ceilings[] = {5000, 10000, 20000, 30000, 30000, 30000};
+  for (uint32_t ceiling : ceilings) {
+    ReconnectBackoff low = backoff, high = backoff;
+    EXPECT_EQ(low.next_delay_ms(0), ceiling / 2);
+    EXPECT_EQ(high.next_delay_ms(ceiling / 2), ceiling);
+    uint32_t delay = backoff.next_delay_ms(12345);
+    EXPECT_GE(delay, ceiling / 2);
+    EXPECT_LE(delay, ceiling);
+  }
+}
+
+TEST(ReconnectBackoff, ResetStartsOver) {
+  ReconnectBackoff backoff;
+  for (int i = 0; i < 20; i++) {
+    backoff.next_delay_ms(0);
+  }
+  EXPECT_EQ(backoff.get_attempts(), 20);
+  backoff.reset();
+  EXPECT_EQ(backoff.next_delay_ms(0), 2500u);
+}
+
+// esp_websocket_client 1.7.0: the configured delay is latched before DISCONNECTED
+// is dispatched, so the handler's set_reconnect_timeout() takes effect one drop later
+struct LatchingClient {
+  uint32_t configured_ms = 0;
+
+  uint32_t drop(ReconnectBackoff &backoff, uint32_t random) {
+    uint32_t waited = configured_ms;
+    configured_ms = backoff.on_disconnected(random);
+    return waited;
+  }
+};
+
+TEST(ReconnectBackoff, StaysOneDropAheadOfTheClient) {
+  ReconnectBackoff backoff;
+  backoff.set_base_delay_ms(5000);
+  backoff.set_max_delay_ms(30000);
+
+  LatchingClient client;
+  client.configured_ms = backoff.on_connected(0);  // start(); no jitter, so each wait is half its step
+  std::vector<uint32_t> waits;
+  for (int i = 0; i < 5; i++) {
+    waits.push_back(client.drop(backoff, 0));
+  }
+  EXPECT_EQ(waits, (std::vector<uint32_t>{2500, 5000, 10000, 15000, 15000}));
+
+  // connecting again means the next outage starts at the base delay, not the cap
+  client.configured_ms = backoff.on_connected(0);
+  EXPECT_EQ(client.drop(backoff, 0), 2500u);
+  EXPECT_EQ(client.drop(backoff, 0), 5000u);
+}
+
+TEST(ReconnectBackoff, LargeBaseDoesNotOverflow) {
+  ReconnectBackoff backoff;
+  backoff.set_base_delay_ms(3000000000u);
+  backoff.set_max_delay_ms(4000000000u);
+  for (int i = 0; i < 40; i++) {
+    EXPECT_LE(backoff.next_delay_ms(0), 4000000000u);
+  }
+}
+
+TEST(RecoveryAction, FollowsElapsedTime) {
+  EXPECT_EQ(recovery_action(0, 1), RecoveryAction::NONE);
+  EXPECT_EQ(recovery_action(RECOVERY_ERROR_AFTER_MS - 1, 10), RecoveryAction::NONE);
+  EXPECT_EQ(recovery_action(RECOVERY_ERROR_AFTER_MS, 1), RecoveryAction::REPORT_ERROR);
+  EXPECT_EQ(recovery_action(RECOVERY_REBOOT_AFTER_MS, RECOVERY_REBOOT_MIN_ATTEMPTS), RecoveryAction::REBOOT);
+  // a single attempt stuck in a long timeout isn't enough to reboot
+  EXPECT_EQ(recovery_action(10 * RECOVERY_REBOOT_AFTER_MS, 1), RecoveryAction::REPORT_ERROR);
+}
+
+TEST(ConnectionMonitor, MeasuresTheOutageFromTheFirstDrop) {
+  esphome::host_set_millis(1000);
+  ConnectionMonitor monitor;
+  EXPECT_FALSE(monitor.is_down());
+  EXPECT_EQ(monitor.check(), RecoveryAction::NONE);
+
+  EXPECT_EQ(monitor.on_disconnected(), 1);
+  esphome::host_set_millis(1000 + RECOVERY_ERROR_AFTER_MS - 1);
+  EXPECT_EQ(monitor.on_disconnected(), 2);
+  EXPECT_EQ(monitor.get_down_ms(), RECOVERY_ERROR_AFTER_MS - 1);
+  EXPECT_EQ(monitor.check(), RecoveryAction::NONE);
+
+  esphome::host_set_millis(1000 + RECOVERY_ERROR_AFTER_MS);
+  EXPECT_EQ(monitor.check(), RecoveryAction::REPORT_ERROR);
+
+  esphome::host_set_millis(1000 + RECOVERY_REBOOT_AFTER_MS);
+  EXPECT_EQ(monitor.check(), RecoveryAction::REPORT_ERROR);  // only two attempts
+  for (int i = 2; i < RECOVERY_REBOOT_MIN_ATTEMPTS; i++) {
+    monitor.on_disconnected();
+  }
+  EXPECT_EQ(monitor.check(), RecoveryAction::REBOOT);
+}
+
+TEST(ConnectionMonitor, ConnectingEndsTheOutage) {
+  esphome::host_set_millis(0);
+  ConnectionMonitor monitor;
+  monitor.on_disconnected();
+  EXPECT_TRUE(monitor.is_down());  // even when it starts at millis() == 0
+
+  esphome::host_set_millis(RECOVERY_REBOOT_AFTER_MS);
+  monitor.on_connected();
+  EXPECT_FALSE(monitor.is_down());
+  EXPECT_EQ(monitor.get_attempts(), 0);
+  EXPECT_EQ(monitor.check(), RecoveryAction::NONE);
+
+  // the next outage is timed from its own first drop
+  monitor.on_disconnected();
+  esphome::host_set_millis(RECOVERY_REBOOT_AFTER_MS + 1000);
+  EXPECT_EQ(monitor.get_down_ms(), 1000u);
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "reconnect_policy.h"
+#include "session_replay.h"
+
+using namespace transit_tracker_test;
+using esphome::transit_tracker::RECOVERY_ERROR_AFTER_MS;
+using esphome::transit_tracker::RECOVERY_REBOOT_AFTER_MS;
+using esphome::transit_tracker::RECOVERY_REBOOT_MIN_ATTEMPTS;
+
+static std::vector<std::string> session_files() {
+  std::vector<std::string> files;
+  for (const auto &entry : std::filesystem::directory_iterator(TT_SESSIONS_DIR)) {
+    if (entry.path().extension() == ".session") {
+      files.push_back(entry.path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+class SessionReplayTest : public testing::TestWithParam<std::string> {};
+
+TEST_P(SessionReplayTest, MeetsExpectations) {
+  auto result = replay_session_file(GetParam());
+  for (const auto &failure : result.failures) {
+    ADD_FAILURE() << failure;
+  }
+  if (HasFailure()) {
+    print_report(result, stderr);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Sessions, SessionReplayTest, testing::ValuesIn(session_files()),
+                         [](const testing::TestParamInfo<std::string> &info) {
+                           return std::filesystem::path(info.param).stem().string();
+                         });
+
+TEST(SessionReplay, SlowLinkShowsRowsBeforeTheMessageCompletes) {
+  auto result = replay_session_file(std::string(TT_SESSIONS_DIR) + "/slow_link_large_schedule.session");
+  ASSERT_EQ(result.messages.size(), 1u);
+  const auto &trace = result.messages[0];
+  ASSERT_TRUE(trace.shown_early());
+  // The first three trips are a few hundred bytes of a ~38 KB message
+  EXPECT_LT(trace.visible_ms - trace.first_chunk_ms, (trace.delivered_ms - trace.first_chunk_ms) / 10);
+}
+
+TEST(SessionReplay, ReportsScriptErrors) {
+  auto result = replay_script("send\nfrobnicate\nexpect delivered 1\n", ".");
+  EXPECT_EQ(result.failures.size(), 3u);
+}
+
+TEST(SessionReplay, DroppedMessageDoesNotBlockTheNextEarlyRender) {
+  // the first schedule fails to inflate partway through and is dropped by the client
+  // without a disconnect; the scan must start over for the next one
+  auto result = replay_script(
+      "buffer 256\nlink 16000\nlimit 3\ndeflate on\nsend fragments=4 garble=1501 @../data/schedule_large.json\n"
+      "send fragments=4 @../data/schedule_large.json\n"
+      "expect dropped 1\nexpect delivered 1\nexpect early 1\nexpect disconnects 0\n",
+      TT_SESSIONS_DIR);
+  for (const auto &failure : result.failures) {
+    ADD_FAILURE() << failure;
+  }
+}
+
+// End to end timing on the replay clock, with connections refused or timing out
+TEST(RecoveryTiming, ShortOutagesRecoverWithoutErrors) {
+  auto result = replay_script("outage 4000\n", ".");
+  ASSERT_EQ(result.outages.size(), 1u);
+  EXPECT_LT(result.outages[0].reconnected_ms, 15000);
+  EXPECT_EQ(result.errors(), 0u);
+}
+
+TEST(RecoveryTiming, LongOutagesRebootAfterTwoMinutes) {
+  for (const char *script : {"outage 600000\n", "outage 600000 10000\n"}) {
+    auto result = replay_script(script, ".");
+    ASSERT_EQ(result.outages.size(), 1u);
+    const auto &outage = result.outages[0];
+    // raised on the first main loop pass past the threshold
+    EXPECT_GE(outage.error_ms, RECOVERY_ERROR_AFTER_MS) << script;
+    EXPECT_LT(outage.error_ms, RECOVERY_ERROR_AFTER_MS + 20) << script;
+    EXPECT_GE(outage.reboot_ms, RECOVERY_REBOOT_AFTER_MS) << script;
+    EXPECT_LT(outage.reboot_ms, RECOVERY_REBOOT_AFTER_MS + 60000) << script;
+    EXPECT_GE(outage.attempts, RECOVERY_REBOOT_MIN_ATTEMPTS) << script;
+  }
+}
+
+TEST(RecoveryTiming, ServerRestartSpreadsReconnects) {
+  // Different jitter per sign: replays with different seeds land at different times
+  auto result = replay_script("outage 30000\noutage 30000\noutage 30000\n", ".");
+  ASSERT_EQ(result.outages.size(), 3u);
+  EXPECT_EQ(result.reboots(), 0u);
+  EXPECT_NE(result.outages[0].reconnected_ms, result.outages[1].reconnected_ms);
+}
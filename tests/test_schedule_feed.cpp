@@ -0,0 +1,164 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "schedule_feed.h"
+
+using namespace esphome::transit_tracker;
+
+static BulkString read_data(const std::string &name) {
+  std::ifstream file(std::string(TT_DATA_DIR) + "/" + name, std::ios::binary);
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  std::string data = contents.str();
+  return BulkString(data.data(), data.size());
+}
+
+namespace {
+
+class ScheduleFeedTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    feed_.set_limit(2);
+    feed_.build_filter();
+    feed_.set_on_heartbeat([this]() { heartbeats_++; });
+    feed_.set_on_parse_error([this]() { parse_errors_++; });
+    feed_.set_on_published([this](uint32_t generation) { published_.push_back(generation); });
+    feed_.set_on_dictionaries([this](JsonObject data, const BulkString &) {
+      dictionary_versions_.push_back(data["version"] | "");
+    });
+  }
+
+  // Delivers a whole message the way WebSocketClient does
+  void deliver(const BulkString &message) {
+    feed_.on_message_start();
+    feed_.handle_message(message);
+  }
+
+  std::vector<std::string> headsigns() {
+    std::vector<std::string> out;
+    for (const Trip &trip : state_.visible(SIZE_MAX)) {
+      out.emplace_back(trip.headsign.data(), trip.headsign.size());
+    }
+    return out;
+  }
+
+  ScheduleState state_;
+  ScheduleFeed feed_{state_};
+  int heartbeats_ = 0;
+  int parse_errors_ = 0;
+  std::vector<uint32_t> published_;
+  std::vector<std::string> dictionary_versions_;
+};
+
+TEST_F(ScheduleFeedTest, PublishesSchedulesWithSpareTrips) {
+  deliver(read_data("schedule_large.json"));
+  ASSERT_EQ(published_.size(), 1u);
+  EXPECT_EQ(published_[0], state_.generation());
+  // limit plus two spares, soonest first
+  ASSERT_EQ(headsigns().size(), 4u);
+  EXPECT_EQ(headsigns()[0], "Seattle Center");
+
+  const Trip &first = state_.front();
+  EXPECT_EQ(first.route_name, "8");
+  EXPECT_EQ(first.route_color, esphome::Color(0x0f6ab4));
+  EXPECT_EQ(first.departure_time, 1760800042);
+  EXPECT_EQ(first.arrival_time, 0);
+  EXPECT_TRUE(first.is_realtime);
+}
+
+TEST_F(ScheduleFeedTest, UsesArrivalTimesWhenConfigured) {
+  feed_.set_display_departure_times(false);
+  feed_.build_filter();
+  state_.set_sort_by_departure(false);
+  deliver(read_data("schedule_small.json"));
+  EXPECT_EQ(state_.front().arrival_time, 1760800028);
+  EXPECT_EQ(state_.front().departure_time, 0);
+}
+
+TEST_F(ScheduleFeedTest, DropsTripsThatAlreadyLeft) {
+  feed_.set_clock_source([]() -> time_t { return 1760800258 + STALE_TRIP_SECONDS; });
+  deliver(read_data("schedule_small.json"));
+  // departures at ...058 and ...288; only the second is within a minute of now
+  EXPECT_EQ(headsigns(), (std::vector<std::string>{"Seattle Center", "University District"}));
+}
+
+TEST_F(ScheduleFeedTest, AppliesDictionaries) {
+  auto dictionaries = std::make_shared<Dictionaries>();
+  dictionaries->abbreviations.emplace_back("Transit Center", "TC");
+  dictionaries->route_styles["1_102548"] = RouteStyle{"B", esphome::Color(0x123456)};
+  feed_.set_dictionaries_source([dictionaries]() { return dictionaries; });
+
+  deliver(read_data("schedule_small.json"));
+  EXPECT_EQ(headsigns()[0], "Bellevue TC Crossroads");
+  EXPECT_EQ(state_.front().route_name, "B");
+  EXPECT_EQ(state_.front().route_color, esphome::Color(0x123456));
+}
+
+TEST_F(ScheduleFeedTest, RoutesOtherEvents) {
+  deliver(read_data("heartbeat.json"));
+  deliver(read_data("dictionaries.json"));
+  deliver(BulkString("{\"event\":\"unknown\",\"data\":{}}"));
+  EXPECT_EQ(heartbeats_, 1);
+  EXPECT_EQ(dictionary_versions_, (std::vector<std::string>{"3f9c2a71"}));
+  EXPECT_TRUE(published_.empty());
+  EXPECT_EQ(parse_errors_, 0);
+}
+
+TEST_F(ScheduleFeedTest, ReportsUnparsableMessages) {
+  deliver(BulkString("{\"event\":\"schedule\",\"data\":{\"trips\":[{"));
+  EXPECT_EQ(parse_errors_, 1);
+  EXPECT_TRUE(published_.empty());
+}
+
+TEST_F(ScheduleFeedTest, EmptySchedulesClearTheTrips) {
+  deliver(read_data("schedule_small.json"));
+  deliver(read_data("schedule_empty.json"));
+  EXPECT_EQ(published_.size(), 2u);
+  EXPECT_TRUE(state_.empty());
+}
+
+TEST_F(ScheduleFeedTest, PublishesLeadingTripsBeforeTheMessageCompletes) {
+  const BulkString message = read_data("schedule_large.json");
+  feed_.on_message_start();
+  size_t shown_at = 0;
+  for (size_t len = 64; len < message.size(); len += 64) {
+    feed_.handle_partial_message(BulkString(message.data(), len));
+    if (!published_.empty() && shown_at == 0) {
+      shown_at = len;
+    }
+  }
+  ASSERT_EQ(published_.size(), 1u);  // once per message
+  EXPECT_LT(shown_at, message.size() / 10);
+  EXPECT_EQ(headsigns().size(), 2u);
+  EXPECT_EQ(headsigns()[0], "Seattle Center");
+
+  // the complete message then replaces them, spares included
+  feed_.handle_message(message);
+  EXPECT_EQ(published_.size(), 2u);
+  EXPECT_EQ(headsigns().size(), 4u);
+}
+
+TEST_F(ScheduleFeedTest, MessageStartResetsThePartialScan) {
+  const BulkString message = read_data("schedule_large.json");
+  feed_.on_message_start();
+  feed_.handle_partial_message(BulkString(message.data(), 2000));
+  ASSERT_EQ(published_.size(), 1u);
+
+  // that message was dropped by the client; the next one starts over
+  feed_.on_message_start();
+  feed_.handle_partial_message(BulkString(message.data(), 2000));
+  EXPECT_EQ(published_.size(), 2u);
+}
+
+TEST_F(ScheduleFeedTest, IgnoresPartialMessagesOfOtherEvents) {
+  const BulkString message = read_data("dictionaries.json");
+  feed_.on_message_start();
+  feed_.handle_partial_message(BulkString(message.data(), message.size() - 1));
+  EXPECT_TRUE(published_.empty());
+}
+
+}  // namespace
@@ -0,0 +1,192 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "schedule_renderer.h"
+
+using namespace esphome::transit_tracker;
+using esphome::Color;
+using esphome::display::Display;
+using esphome::font::Font;
+
+// Golden frames live in tests/golden as binary PPM. Run with TT_UPDATE_GOLDEN=1 to
+// rewrite them after an intended rendering change, then review the images.
+
+static constexpr uint NOW = 1760800000;
+static constexpr uint32_t STATUS_UP = RENDER_STATE_NETWORK_UP | RENDER_STATE_TIME_VALID | RENDER_STATE_CONNECTED_EVER;
+
+static Trip trip(const char *route, uint32_t color, const char *headsign, time_t departure, bool realtime) {
+  Trip t{};
+  t.route_id = route;
+  t.route_name = route;
+  t.route_color = Color(color);
+  t.headsign = headsign;
+  t.departure_time = departure;
+  t.is_realtime = realtime;
+  return t;
+}
+
+static BulkVector<Trip> sample_trips() {
+  BulkVector<Trip> trips;
+  trips.push_back(trip("8", 0x0f6ab4, "Seattle Center", NOW + 20, true));
+  trips.push_back(trip("271", 0x7a3e9d, "Bellevue Transit Center Crossroads via Issaquah", NOW + 330, false));
+  trips.push_back(trip("B", 0xfe4c5c, "Crossroads", NOW + 4000, true));
+  return trips;
+}
+
+static std::string to_ppm(const Display &display) {
+  std::string ppm = "P6\n" + std::to_string(display.get_width()) + " " + std::to_string(display.get_height()) + "\n255\n";
+  for (int y = 0; y < display.get_height(); y++) {
+    for (int x = 0; x < display.get_width(); x++) {
+      Color c = display.get_pixel(x, y);
+      ppm += static_cast<char>(c.r);
+      ppm += static_cast<char>(c.g);
+      ppm += static_cast<char>(c.b);
+    }
+  }
+  return ppm;
+}
+
+static bool read_binary(const std::string &path, std::string &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static void write_binary(const std::string &path, const std::string &data) {
+  std::ofstream(path, std::ios::binary) << data;
+}
+
+namespace {
+
+class ScheduleRendererTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    state_.set_sort_by_departure(true);
+    configure(renderer_);
+  }
+
+  void configure(ScheduleRenderer &renderer) {
+    renderer.set_display(&display_);
+    renderer.set_font(&font_);
+    renderer.set_limit(3);
+    renderer.set_has_base_url(true);
+  }
+
+  void draw(unsigned long uptime, uint rtc_now, uint32_t status) { draw_with(renderer_, uptime, rtc_now, status); }
+
+  void draw_with(ScheduleRenderer &renderer, unsigned long uptime, uint rtc_now, uint32_t status) {
+    display_.clear();
+    renderer.draw(uptime, rtc_now, status);
+  }
+
+  // Compares the current frame with tests/golden/<name>.ppm and reports what it cost to draw
+  void expect_golden(const std::string &name) {
+    std::printf("[   FRAME  ] %s: %zu pixels, %zu text draws\n", name.c_str(), display_.get_pixels_drawn(),
+                display_.get_text_draws());
+    RecordProperty("pixels", static_cast<int>(display_.get_pixels_drawn()));
+    RecordProperty("text_draws", static_cast<int>(display_.get_text_draws()));
+
+    std::string path = std::string(TT_GOLDEN_DIR) + "/" + name + ".ppm";
+    std::string actual = to_ppm(display_);
+    if (std::getenv("TT_UPDATE_GOLDEN") != nullptr) {
+      write_binary(path, actual);
+      return;
+    }
+
+    std::string expected;
+    ASSERT_TRUE(read_binary(path, expected)) << "missing " << path << "; run with TT_UPDATE_GOLDEN=1 to create it";
+    if (actual != expected) {
+      write_binary(name + ".actual.ppm", actual);
+    }
+    ASSERT_EQ(actual.size(), expected.size()) << name << ": frame size changed";
+
+    size_t header = actual.size() - static_cast<size_t>(display_.get_width() * display_.get_height() * 3);
+    size_t differing = 0;
+    int first_x = -1, first_y = -1;
+    for (size_t i = header; i < actual.size(); i += 3) {
+      if (actual.compare(i, 3, expected, i, 3) != 0) {
+        if (differing++ == 0) {
+          first_x = static_cast<int>((i - header) / 3) % display_.get_width();
+          first_y = static_cast<int>((i - header) / 3) / display_.get_width();
+        }
+      }
+    }
+    EXPECT_EQ(differing, 0u) << name << ": first difference at (" << first_x << ", " << first_y << "); wrote "
+                             << name << ".actual.ppm";
+  }
+
+  ScheduleState state_;
+  Localization localization_;
+  ScheduleRenderer renderer_{state_, localization_};
+  Display display_{128, 32};
+  Font font_{8, 2};
+};
+
+TEST_F(ScheduleRendererTest, WaitingForNetwork) {
+  draw(0, NOW, 0);
+  expect_golden("waiting_for_network");
+}
+
+TEST_F(ScheduleRendererTest, ErrorLoadingSchedule) {
+  draw(0, NOW, STATUS_UP | RENDER_STATE_ERROR);
+  expect_golden("error");
+}
+
+TEST_F(ScheduleRendererTest, NoUpcomingDepartures) {
+  draw(0, NOW, STATUS_UP);
+  expect_golden("no_departures");
+}
+
+TEST_F(ScheduleRendererTest, Schedule) {
+  state_.replace(sample_trips());
+  draw(0, NOW, STATUS_UP);
+  expect_golden("schedule");
+}
+
+TEST_F(ScheduleRendererTest, RealtimeIconAnimates) {
+  state_.replace(sample_trips());
+  // 400 ms into the animation, every segment is lit
+  draw(3400, NOW, STATUS_UP);
+  expect_golden("schedule_icon_lit");
+}
+
+TEST_F(ScheduleRendererTest, LongHeadsignsScroll) {
+  renderer_.set_scroll_headsigns(true);
+  state_.replace(sample_trips());
+  // 2 s into the scroll, at 10 px/s
+  draw(7000, NOW, STATUS_UP);
+  expect_golden("schedule_scrolled");
+}
+
+TEST_F(ScheduleRendererTest, CachedRowLayoutsDrawWhatAFreshRendererDraws) {
+  ScheduleRenderer fresh(state_, localization_);
+  configure(fresh);
+  renderer_.set_scroll_headsigns(true);
+  fresh.set_scroll_headsigns(true);
+
+  state_.replace(sample_trips());
+  draw(7000, NOW, STATUS_UP);
+  draw(7000, NOW + 90, STATUS_UP);  // "5min" becomes "4min"
+  std::string cached = to_ppm(display_);
+  draw_with(fresh, 7000, NOW + 90, STATUS_UP);
+  EXPECT_EQ(cached, to_ppm(display_));
+
+  // A new schedule with the same number of rows is measured again, so nothing scrolls
+  BulkVector<Trip> trips = sample_trips();
+  trips[1].headsign = "Issaquah";
+  state_.replace(std::move(trips));
+  draw(7000, NOW + 90, STATUS_UP);
+  cached = to_ppm(display_);
+  draw_with(fresh, 7000, NOW + 90, STATUS_UP);
+  EXPECT_EQ(cached, to_ppm(display_));
+}
+
+}  // namespace
@@ -0,0 +1,110 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "schedule_state.h"
+
+using esphome::transit_tracker::BulkVector;
+using esphome::transit_tracker::ScheduleState;
+using esphome::transit_tracker::Trip;
+
+static Trip trip(const char *route, time_t arrival, time_t departure) {
+  Trip t{};
+  t.route_id = route;
+  t.arrival_time = arrival;
+  t.departure_time = departure;
+  return t;
+}
+
+static std::vector<std::string> routes(ScheduleState::Range range) {
+  std::vector<std::string> out;
+  for (const Trip &t : range) {
+    out.emplace_back(t.route_id.data(), t.route_id.size());
+  }
+  return out;
+}
+
+static BulkVector<Trip> mixed_trips() {
+  // Departure order is b, a, c; arrival order is c, a, b
+  BulkVector<Trip> trips;
+  trips.push_back(trip("a", 200, 210));
+  trips.push_back(trip("b", 300, 100));
+  trips.push_back(trip("c", 100, 400));
+  return trips;
+}
+
+TEST(ScheduleState, ReplaceSortsByDeparture) {
+  ScheduleState state;
+  state.replace(mixed_trips());
+  EXPECT_EQ(routes(state.visible(10)), (std::vector<std::string>{"b", "a", "c"}));
+}
+
+TEST(ScheduleState, ReplaceSortsByArrival) {
+  ScheduleState state;
+  state.set_sort_by_departure(false);
+  state.replace(mixed_trips());
+  EXPECT_EQ(routes(state.visible(10)), (std::vector<std::string>{"c", "a", "b"}));
+  EXPECT_EQ(state.front().route_id, "c");
+}
+
+TEST(ScheduleState, ReplaceKeepsServerOrderForTies) {
+  ScheduleState state;
+  BulkVector<Trip> trips;
+  trips.push_back(trip("x", 0, 500));
+  trips.push_back(trip("y", 0, 100));
+  trips.push_back(trip("z", 0, 500));
+  state.replace(std::move(trips));
+  EXPECT_EQ(routes(state.visible(10)), (std::vector<std::string>{"y", "x", "z"}));
+}
+
+TEST(ScheduleState, ExpireBeforeKeepsTripsAtTheCutoff) {
+  ScheduleState state;
+  state.replace(mixed_trips());  // departures 100, 210, 400
+
+  EXPECT_EQ(state.expire_before(100), 0u);
+  EXPECT_EQ(state.expire_before(210), 1u);
+  EXPECT_EQ(routes(state.visible(10)), (std::vector<std::string>{"a", "c"}));
+  EXPECT_EQ(state.expire_before(401), 2u);
+  EXPECT_TRUE(state.empty());
+  EXPECT_EQ(state.expire_before(1000), 0u);
+}
+
+TEST(ScheduleState, ExpireBeforeUsesTheDisplayedTime) {
+  ScheduleState state;
+  state.set_sort_by_departure(false);
+  state.replace(mixed_trips());  // arrivals 100, 200, 300
+  EXPECT_EQ(state.expire_before(201), 2u);
+  EXPECT_EQ(routes(state.visible(10)), (std::vector<std::string>{"b"}));
+}
+
+TEST(ScheduleState, GenerationBumpsOnlyOnChanges) {
+  ScheduleState state;
+  EXPECT_EQ(state.generation(), 0u);
+
+  state.replace(mixed_trips());
+  EXPECT_EQ(state.generation(), 1u);
+
+  // nothing expired, so nothing to redraw
+  state.expire_before(0);
+  EXPECT_EQ(state.generation(), 1u);
+
+  state.expire_before(150);
+  EXPECT_EQ(state.generation(), 2u);
+
+  // an empty schedule still replaces whatever was shown
+  state.replace(BulkVector<Trip>());
+  EXPECT_EQ(state.generation(), 3u);
+  EXPECT_TRUE(state.empty());
+}
+
+TEST(ScheduleState, VisibleClampsToTheTripCount) {
+  ScheduleState state;
+  EXPECT_TRUE(routes(state.visible(3)).empty());
+
+  state.replace(mixed_trips());
+  EXPECT_TRUE(routes(state.visible(0)).empty());
+  EXPECT_EQ(routes(state.visible(2)), (std::vector<std::string>{"b", "a"}));
+  EXPECT_EQ(routes(state.visible(3)).size(), 3u);
+  EXPECT_EQ(routes(state.visible(100)).size(), 3u);
+}
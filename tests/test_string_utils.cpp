@@ -0,0 +1,50 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "string_utils.h"
+
+static std::vector<std::string> tokens(std::string_view text, char delim) {
+  std::vector<std::string> out;
+  Tokenizer tokenizer(text, delim);
+  std::string_view token;
+  while (tokenizer.next(token)) {
+    out.emplace_back(token);
+  }
+  return out;
+}
+
+TEST(Tokenizer, SplitsLikeGetline) {
+  EXPECT_EQ(tokens("a\nb\n\nc", '\n'), (std::vector<std::string>{"a", "b", "", "c"}));
+  EXPECT_EQ(tokens("a\nb\n", '\n'), (std::vector<std::string>{"a", "b"}));
+  EXPECT_EQ(tokens("\n", '\n'), (std::vector<std::string>{""}));
+  EXPECT_TRUE(tokens("", '\n').empty());
+}
+
+TEST(SplitFields, CountsFieldsPastTheLimit) {
+  std::string_view fields[2];
+  EXPECT_EQ(split_fields("a;b;c", ';', fields, 2), 3u);
+  EXPECT_EQ(fields[0], "a");
+  EXPECT_EQ(fields[1], "b");
+
+  EXPECT_EQ(split_fields(";x", ';', fields, 2), 2u);
+  EXPECT_EQ(fields[0], "");
+  EXPECT_EQ(fields[1], "x");
+}
+
+TEST(ParseHexColor, AcceptsOneToSixDigits) {
+  uint32_t color = 0;
+  EXPECT_TRUE(parse_hex_color("ff4040", color));
+  EXPECT_EQ(color, 0xff4040u);
+  EXPECT_TRUE(parse_hex_color("A", color));
+  EXPECT_EQ(color, 0xAu);
+}
+
+TEST(ParseHexColor, RejectsAnythingElse) {
+  uint32_t color = 7;
+  for (const char *bad : {"", "1234567", "0x12", "-1", " 1", "12 ", "gg", "+f"}) {
+    EXPECT_FALSE(parse_hex_color(bad, color)) << bad;
+  }
+  EXPECT_EQ(color, 7u);
+}